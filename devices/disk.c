@@ -1,12 +1,15 @@
 #include "devices/disk.h"
 #include <ctype.h>
 #include <debug.h>
+#include <list.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -48,6 +51,9 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
+/* Most sectors one READ SECTOR or WRITE SECTOR command moves. */
+#define MULTI_MAX 256
+
 /* An ATA device. */
 struct disk {
 	char name[8];               /* Name, e.g. "hd0:1". */
@@ -59,6 +65,8 @@ struct disk {
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
+
+	struct stripe *stripe;      /* Members, if a striped volume. */
 };
 
 /* An ATA channel (aka controller).
@@ -84,7 +92,7 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -96,6 +104,22 @@ static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
 
+/* Where the sectors of a transfer are in memory.  They come in
+   runs of RUN sectors, each run STRIDE sectors after the one before,
+   and the first is sector SKIP of its run.  Sectors that are simply
+   one after another have RUN == STRIDE and SKIP == 0. */
+struct layout {
+	uint8_t *buffer;            /* First sector. */
+	size_t run;                 /* Sectors per run. */
+	size_t stride;              /* Sectors from one run to the next. */
+	size_t skip;                /* Sectors of the first run skipped. */
+};
+
+static void transfer (struct disk *, disk_sector_t, size_t cnt,
+		const struct layout *, bool write);
+static void stripe_io (struct disk *, disk_sector_t, void *, size_t cnt,
+		bool write);
+
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
@@ -209,21 +233,10 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
-	struct channel *c;
-
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	disk_read_many (d, sec_no, buffer, 1);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -233,22 +246,306 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
    per-disk locking is unneeded. */
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
-	struct channel *c;
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+
+	disk_write_many (d, sec_no, buffer, 1);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   using as few commands as the disk allows.
+   On a striped volume, the member disks transfer their parts at
+   the same time. */
+void
+disk_read_many (struct disk *d, disk_sector_t sec_no, void *buffer,
+		size_t cnt) {
+	struct layout l = { buffer, 1, 1, 0 };
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
-	c = d->channel;
+	if (d->stripe != NULL)
+		stripe_io (d, sec_no, buffer, cnt, false);
+	else
+		transfer (d, sec_no, cnt, &l, false);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   using as few commands as the disk allows.
+   On a striped volume, the member disks transfer their parts at
+   the same time. */
+void
+disk_write_many (struct disk *d, disk_sector_t sec_no, const void *buffer,
+		size_t cnt) {
+	struct layout l = { (uint8_t *) buffer, 1, 1, 0 };
+
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+
+	if (d->stripe != NULL)
+		stripe_io (d, sec_no, (void *) buffer, cnt, true);
+	else
+		transfer (d, sec_no, cnt, &l, true);
+}
+
+/* Returns where sector I of a transfer laid out as L is in
+   memory. */
+static uint8_t *
+layout_sector (const struct layout *l, size_t i) {
+	size_t pos = l->skip + i;
+
+	return l->buffer + ((pos / l->run) * l->stride + pos % l->run - l->skip)
+		* DISK_SECTOR_SIZE;
+}
+
+/* Transfers CNT sectors of ATA disk D starting at SEC_NO to or
+   from memory laid out as L, MULTI_MAX sectors per command.  The
+   disk interrupts once for each sector: on a read when the sector
+   is ready to be input, on a write when it has taken the sector
+   output before. */
+static void
+transfer (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		const struct layout *l, bool write) {
+	struct channel *c = d->channel;
+	size_t done = 0;
+
+	ASSERT (d->stripe == NULL);
+
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
+	while (done < cnt) {
+		size_t batch = cnt - done < MULTI_MAX ? cnt - done : MULTI_MAX;
+		size_t i;
+
+		select_sector (d, sec_no + done, batch);
+		issue_pio_command (c, write ? CMD_WRITE_SECTOR_RETRY
+				: CMD_READ_SECTOR_RETRY);
+		for (i = done; i < done + batch; i++) {
+			if (write) {
+				if (!wait_while_busy (d))
+					PANIC ("%s: disk write failed, sector=%"PRDSNu,
+							d->name, sec_no + (disk_sector_t) i);
+				output_sector (c, layout_sector (l, i));
+				sema_down (&c->completion_wait);
+			} else {
+				sema_down (&c->completion_wait);
+				if (!wait_while_busy (d))
+					PANIC ("%s: disk read failed, sector=%"PRDSNu,
+							d->name, sec_no + (disk_sector_t) i);
+				input_sector (c, layout_sector (l, i));
+			}
+		}
+		done += batch;
+	}
+	if (write)
+		d->write_cnt += cnt;
+	else
+		d->read_cnt += cnt;
 	lock_release (&c->lock);
 }
+
+/* Striped volumes.
+
+   A striped volume spreads its sectors over up to STRIPE_MAX member
+   disks, RAID-0 style: the volume is cut into chunks of CHUNK
+   sectors, and chunk N lives on member N % MEMBER_CNT.  A transfer
+   of many sectors is split by member.  Member 0's part is done by
+   the caller, and every other member's part by a worker thread of
+   its own, so that members on different channels work at the same
+   time. */
+#define STRIPE_MAX 4
+
+/* A transfer, or the part of it for one member. */
+struct stripe_request {
+	struct list_elem elem;      /* Element in a member's queue. */
+	disk_sector_t sec_no;       /* First volume sector. */
+	uint8_t *buffer;            /* Data for the volume sectors. */
+	size_t cnt;                 /* Number of volume sectors. */
+	bool write;                 /* Write, not read? */
+	struct semaphore done;      /* Up'd when the member is done. */
+};
+
+/* A member disk and the work queued for it. */
+struct stripe_member {
+	struct disk *disk;          /* Member disk. */
+	struct disk *volume;        /* Volume it is a member of. */
+	size_t idx;                 /* Index in the volume's members. */
+	struct list queue;          /* Queued stripe_requests. */
+	struct lock lock;           /* Protects QUEUE. */
+	struct semaphore pending;   /* Counts QUEUE's requests. */
+};
+
+/* A striped volume. */
+struct stripe {
+	disk_sector_t chunk;        /* Sectors per chunk. */
+	size_t member_cnt;          /* Number of members. */
+	struct stripe_member members[STRIPE_MAX];
+	struct lock lock;           /* Protects the volume's counters. */
+};
+
+static void stripe_worker (void *member_);
+
+/* Creates and returns a volume striped over the CNT disks in
+   MEMBERS in chunks of CHUNK sectors.  Its size is CNT times the
+   size of the smallest member, rounded down to whole chunks, and
+   it takes that many sectors from the start of each member.  Those
+   sectors should not be used on their own afterward.  Returns a
+   null pointer if memory is short. */
+struct disk *
+disk_stripe (struct disk *members[], size_t cnt, disk_sector_t chunk) {
+	struct disk *v;
+	struct stripe *s;
+	disk_sector_t size;
+	size_t i;
+
+	ASSERT (cnt >= 1 && cnt <= STRIPE_MAX);
+	ASSERT (chunk > 0);
+
+	v = calloc (1, sizeof *v);
+	s = calloc (1, sizeof *s);
+	if (v == NULL || s == NULL) {
+		free (v);
+		free (s);
+		return NULL;
+	}
+
+	size = disk_size (members[0]);
+	for (i = 0; i < cnt; i++) {
+		struct stripe_member *m = &s->members[i];
+
+		ASSERT (members[i] != NULL && members[i]->stripe == NULL);
+		if (disk_size (members[i]) < size)
+			size = disk_size (members[i]);
+		m->disk = members[i];
+		m->volume = v;
+		m->idx = i;
+		list_init (&m->queue);
+		lock_init (&m->lock);
+		sema_init (&m->pending, 0);
+	}
+	s->chunk = chunk;
+	s->member_cnt = cnt;
+	lock_init (&s->lock);
+
+	snprintf (v->name, sizeof v->name, "stripe");
+	v->is_ata = false;
+	v->capacity = size / chunk * chunk * cnt;
+	v->stripe = s;
+	for (i = 1; i < cnt; i++)
+		thread_create (members[i]->name, PRI_DEFAULT, stripe_worker,
+				&s->members[i]);
+
+	printf ("stripe: %zu disks, %"PRDSNu"-sector chunks, %"PRDSNu" sectors\n",
+			cnt, chunk, v->capacity);
+	return v;
+}
+
+/* Transfers the sectors of R that lie on member M of volume V.
+   They are one range of sectors on the member, since its chunks
+   are consecutive there, so they move in one transfer that
+   scatters or gathers the member's chunks in R's buffer. */
+static void
+stripe_transfer (struct disk *v, size_t m, const struct stripe_request *r) {
+	struct stripe *s = v->stripe;
+	size_t n = s->member_cnt;
+	disk_sector_t end = r->sec_no + r->cnt;
+	disk_sector_t first = r->sec_no / s->chunk;
+	disk_sector_t last = (end - 1) / s->chunk;
+	disk_sector_t start, stop;
+	struct layout l;
+
+	/* First and last chunks of R on member M. */
+	first += (m + n - first % n) % n;
+	if (first * s->chunk >= end)
+		return;
+	last -= (last % n + n - m) % n;
+
+	/* Volume sectors of R from the first of them on M through the
+	   last. */
+	start = first * s->chunk > r->sec_no ? first * s->chunk : r->sec_no;
+	stop = (last + 1) * s->chunk < end ? (last + 1) * s->chunk : end;
+
+	l.buffer = r->buffer + (start - r->sec_no) * DISK_SECTOR_SIZE;
+	l.run = s->chunk;
+	l.stride = n * s->chunk;
+	l.skip = start - first * s->chunk;
+	transfer (s->members[m].disk,
+			first / n * s->chunk + l.skip,
+			(last - first) / n * s->chunk + (stop - last * s->chunk) - l.skip,
+			&l, r->write);
+}
+
+/* Transfers CNT sectors of volume V starting at SEC_NO to or from
+   BUFFER.  Members the transfer reaches, other than member 0, get
+   their parts done by their workers while the caller does member
+   0's. */
+static void
+stripe_io (struct disk *v, disk_sector_t sec_no, void *buffer, size_t cnt,
+		bool write) {
+	struct stripe *s = v->stripe;
+	struct stripe_request reqs[STRIPE_MAX];
+	struct stripe_request r;
+	size_t first = sec_no / s->chunk % s->member_cnt;
+	size_t chunk_cnt;
+	size_t m;
+
+	ASSERT (sec_no + cnt <= v->capacity);
+	if (cnt == 0)
+		return;
+
+	r.sec_no = sec_no;
+	r.buffer = buffer;
+	r.cnt = cnt;
+	r.write = write;
+	chunk_cnt = (sec_no + cnt - 1) / s->chunk - sec_no / s->chunk + 1;
+
+	/* A transfer within one chunk involves one member only. */
+	if (chunk_cnt == 1 && first != 0) {
+		stripe_transfer (v, first, &r);
+	} else {
+		for (m = 1; m < s->member_cnt; m++) {
+			struct stripe_member *member = &s->members[m];
+
+			if ((m + s->member_cnt - first) % s->member_cnt >= chunk_cnt)
+				continue;
+			reqs[m] = r;
+			sema_init (&reqs[m].done, 0);
+			lock_acquire (&member->lock);
+			list_push_back (&member->queue, &reqs[m].elem);
+			lock_release (&member->lock);
+			sema_up (&member->pending);
+		}
+		stripe_transfer (v, 0, &r);
+		for (m = 1; m < s->member_cnt; m++)
+			if ((m + s->member_cnt - first) % s->member_cnt < chunk_cnt)
+				sema_down (&reqs[m].done);
+	}
+
+	lock_acquire (&s->lock);
+	if (write)
+		v->write_cnt += cnt;
+	else
+		v->read_cnt += cnt;
+	lock_release (&s->lock);
+}
+
+/* Worker for one member of a striped volume.  Does that member's
+   part of each transfer queued for it. */
+static void
+stripe_worker (void *member_) {
+	struct stripe_member *m = member_;
+
+	for (;;) {
+		struct stripe_request *r;
+
+		sema_down (&m->pending);
+		lock_acquire (&m->lock);
+		r = list_entry (list_pop_front (&m->queue), struct stripe_request, elem);
+		lock_release (&m->lock);
+
+		stripe_transfer (m->volume, m->idx, r);
+		sema_up (&r->done);
+	}
+}
 
 /* Disk detection and identification. */
 
@@ -402,17 +699,18 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT to the disk's sector selection and sector
+   count registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt >= 1 && cnt <= MULTI_MAX);
+	ASSERT (sec_no + cnt <= d->capacity);
+	ASSERT (sec_no + cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt == MULTI_MAX ? 0 : cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -0,0 +1,179 @@
+/* dcache.c: Directory entry cache.
+ *
+ * Remembers the outcome of recent directory lookups, keyed by the
+ * disk and sector of the directory's inode and the name looked up:
+ * either the sector
+ * of the file's inode or DCACHE_NEGATIVE for a name that is known not
+ * to exist.  The directory code inserts an entry after every lookup
+ * that misses and replaces it whenever it adds or removes that very
+ * name, so no other entry is ever touched.
+ *
+ * Entries do not keep their directory open.  When a removed directory
+ * is finally closed, dcache_forget() drops its entries, so that a new
+ * directory created in the same sector starts out with none.  At most
+ * DCACHE_SIZE entries are kept; the least recently used one is evicted
+ * to make room for a new one. */
+
+#include "filesys/dcache.h"
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Maximum number of cached entries. */
+#define DCACHE_SIZE 1024
+
+/* A cached directory entry. */
+struct dentry {
+	struct hash_elem hash_elem;         /* Element in DENTRIES. */
+	struct list_elem lru_elem;          /* Element in LRU. */
+	struct disk *disk;                  /* Disk holding the directory. */
+	disk_sector_t dir;                  /* Directory's inode sector. */
+	char name[NAME_MAX + 1];            /* Name looked up. */
+	disk_sector_t sector;               /* Inode sector or DCACHE_NEGATIVE. */
+};
+
+static struct hash dentries;            /* All cached entries. */
+static struct list lru;                 /* Most recently used first. */
+static size_t dentry_cnt;               /* Number of cached entries. */
+static struct lock dcache_lock;         /* Protects the above. */
+
+/* Statistics. */
+static long long hit_cnt, negative_hit_cnt, miss_cnt;
+
+static uint64_t
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+	return hash_string (d->name) ^ hash_int (d->dir)
+		^ hash_bytes (&d->disk, sizeof d->disk);
+}
+
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+	const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+	if (a->disk != b->disk)
+		return a->disk < b->disk;
+	if (a->dir != b->dir)
+		return a->dir < b->dir;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void) {
+	hash_init (&dentries, dentry_hash, dentry_less, NULL);
+	list_init (&lru);
+	lock_init (&dcache_lock);
+}
+
+/* Returns the cached entry for NAME in DIR, or a null pointer.
+ * Must be called with dcache_lock held. */
+static struct dentry *
+find (struct inode *dir, const char *name) {
+	struct dentry key;
+	struct hash_elem *e;
+
+	key.disk = filesys_disk;
+	key.dir = inode_get_inumber (dir);
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dentries, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Looks up NAME in directory DIR in the cache.  On a hit, stores the
+ * sector of NAME's inode, or DCACHE_NEGATIVE if NAME is known not to
+ * exist, into *SECTOR and returns true.  Returns false on a miss. */
+bool
+dcache_lookup (struct inode *dir, const char *name, disk_sector_t *sector) {
+	struct dentry *d;
+
+	if (strlen (name) > NAME_MAX)
+		return false;
+
+	lock_acquire (&dcache_lock);
+	d = find (dir, name);
+	if (d != NULL) {
+		list_remove (&d->lru_elem);
+		list_push_front (&lru, &d->lru_elem);
+		*sector = d->sector;
+		hit_cnt++;
+		if (d->sector == DCACHE_NEGATIVE)
+			negative_hit_cnt++;
+	} else
+		miss_cnt++;
+	lock_release (&dcache_lock);
+	return d != NULL;
+}
+
+/* Records that NAME in directory DIR refers to the inode at SECTOR,
+ * or does not exist if SECTOR is DCACHE_NEGATIVE, replacing whatever
+ * was cached for NAME before. */
+void
+dcache_insert (struct inode *dir, const char *name, disk_sector_t sector) {
+	struct dentry *d, *victim = NULL;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	d = find (dir, name);
+	if (d == NULL) {
+		if (dentry_cnt >= DCACHE_SIZE) {
+			victim = list_entry (list_pop_back (&lru), struct dentry, lru_elem);
+			hash_delete (&dentries, &victim->hash_elem);
+			dentry_cnt--;
+		}
+		d = malloc (sizeof *d);
+		if (d != NULL) {
+			d->disk = filesys_disk;
+			d->dir = inode_get_inumber (dir);
+			strlcpy (d->name, name, sizeof d->name);
+			hash_insert (&dentries, &d->hash_elem);
+			dentry_cnt++;
+		}
+	} else
+		list_remove (&d->lru_elem);
+	if (d != NULL) {
+		d->sector = sector;
+		list_push_front (&lru, &d->lru_elem);
+	}
+	lock_release (&dcache_lock);
+
+	free (victim);
+}
+
+/* Drops every entry of the directory whose inode is at SECTOR on
+ * filesys_disk.  Called when a removed directory is closed for the
+ * last time, since its sector may be reused. */
+void
+dcache_forget (disk_sector_t sector) {
+	struct list_elem *e, *next;
+
+	lock_acquire (&dcache_lock);
+	for (e = list_begin (&lru); e != list_end (&lru); e = next) {
+		struct dentry *d = list_entry (e, struct dentry, lru_elem);
+
+		next = list_next (e);
+		if (d->disk == filesys_disk && d->dir == sector) {
+			list_remove (&d->lru_elem);
+			hash_delete (&dentries, &d->hash_elem);
+			dentry_cnt--;
+			free (d);
+		}
+	}
+	lock_release (&dcache_lock);
+}
+
+/* Prints directory entry cache statistics. */
+void
+dcache_print_stats (void) {
+	printf ("dcache: %lld hits (%lld negative), %lld misses\n",
+			hit_cnt, negative_hit_cnt, miss_cnt);
+}
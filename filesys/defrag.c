@@ -0,0 +1,137 @@
+/* defrag.c: Online defragmenter.
+ *
+ * A file's data is always one contiguous run, but the run is not
+ * always where it should be.  Once the sectors after a growing file
+ * are taken, it moves to wherever a long enough run is free, and
+ * files created while the disk was full land far from their inodes.
+ * Deleting files then leaves holes between the runs.  Reading such a
+ * file seeks from its inode to its data, and the holes are too short
+ * for the next file that grows.
+ *
+ * The defragd thread walks the root directory and moves the data of
+ * each file to the free run closest to its inode, which packs runs
+ * back behind their inodes and gathers the holes into long free
+ * runs.  It moves at most DEFRAG_SECTORS_PER_TICK sectors for every
+ * tick it sleeps, and holds filesys_lock while it moves a file, so
+ * that no system call sees the file half moved.  Page faults read
+ * files without filesys_lock, so files that are open, which includes
+ * every mapped file and running executable, stay where they are. */
+
+#include "filesys/defrag.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "filesys/directory.h"
+#include "filesys/free-map.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+
+/* Move budget.  defragd wakes up every DEFRAG_SLEEP_TICKS and then
+ * moves files until it has moved DEFRAG_SECTORS_PER_TICK sectors for
+ * every tick it slept. */
+#define DEFRAG_SLEEP_TICKS 10
+#define DEFRAG_SECTORS_PER_TICK 8
+#define DEFRAG_BATCH (DEFRAG_SLEEP_TICKS * DEFRAG_SECTORS_PER_TICK)
+
+/* A file whose data starts more than this many sectors from its
+ * inode counts as out of place. */
+#define DEFRAG_FAR 64
+
+bool defrag_enabled;
+
+/* Root directory being walked, or NULL between passes. */
+static struct dir *cursor;
+
+/* Statistics. */
+static long long pass_cnt;          /* # of completed passes. */
+static long long files_scanned;     /* # of files looked at. */
+static long long files_moved;       /* # of files moved. */
+static long long sectors_moved;     /* # of data sectors copied. */
+static size_t files_far;            /* Out of place files, last pass. */
+static size_t far_cnt;              /* Out of place files, this pass. */
+
+static void defragd (void *aux UNUSED);
+
+/* Starts the defragd thread if the defragmenter is enabled. */
+void
+defrag_init (void) {
+	if (defrag_enabled)
+		thread_create ("defragd", PRI_MIN, defragd, NULL);
+}
+
+/* Moves the next file of the walk closer to its inode.
+ * Returns the number of sectors moved, or -1 at the end of a
+ * pass. */
+static int
+defrag_next (void) {
+	char name[NAME_MAX + 1];
+	struct inode *inode;
+	size_t moved;
+
+	if (cursor == NULL) {
+		cursor = dir_open_root ();
+		if (cursor == NULL)
+			return -1;
+	}
+	if (!dir_readdir (cursor, name)) {
+		dir_close (cursor);
+		cursor = NULL;
+		files_far = far_cnt;
+		far_cnt = 0;
+		pass_cnt++;
+		return -1;
+	}
+	if (!dir_lookup (cursor, name, &inode))
+		return 0;
+
+	journal_begin ();
+	moved = inode_defrag (inode);
+	journal_end ();
+	if (inode_data_distance (inode) > DEFRAG_FAR)
+		far_cnt++;
+	inode_close (inode);
+
+	files_scanned++;
+	if (moved > 0) {
+		files_moved++;
+		sectors_moved += moved;
+	}
+	return moved;
+}
+
+/* Defragmenter daemon.  Sleeps and moves files, forever, at the
+ * lowest priority. */
+static void
+defragd (void *aux UNUSED) {
+	for (;;) {
+		int budget = DEFRAG_BATCH;
+
+		timer_sleep (DEFRAG_SLEEP_TICKS);
+		while (budget > 0) {
+			int moved;
+
+			lock_acquire (&filesys_lock);
+			moved = defrag_next ();
+			lock_release (&filesys_lock);
+			if (moved < 0)
+				break;
+			budget -= moved + 1;
+		}
+	}
+}
+
+/* Prints defragmenter progress and how fragmented the disk is. */
+void
+defrag_print_stats (void) {
+	size_t run_cnt, longest;
+
+	longest = free_map_free_runs (&run_cnt);
+	if (defrag_enabled)
+		printf ("defrag: %lld passes, %lld files scanned, %lld moved, "
+				"%lld sectors moved, %zu files out of place\n",
+				pass_cnt, files_scanned, files_moved, sectors_moved, files_far);
+	printf ("free space: %zu runs, longest %zu sectors\n", run_cnt, longest);
+}
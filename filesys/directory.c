@@ -2,14 +2,21 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <hash.h>
+#include <round.h>
+#include <stddef.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 
 /* A directory. */
 struct dir {
 	struct inode *inode;                /* Backing store. */
 	off_t pos;                          /* Current position. */
+	bool probed;                        /* Header read yet? */
+	uint32_t bucket_cnt;                /* Hash buckets, 0 if linear. */
 };
 
 /* A single directory entry. */
@@ -19,11 +26,125 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* Hashed directories.
+ *
+ * A directory created for more than HASHED_MIN_ENTRIES entries is
+ * laid out as a header sector followed by BUCKET_CNT bucket sectors,
+ * each holding BUCKET_ENTRIES entries.  A name hashes to a home
+ * bucket.  If the home bucket is full, the entry goes into the next
+ * bucket with room, and each full bucket passed on the way counts it
+ * in OVERFLOW, so a lookup can stop at the first bucket whose
+ * OVERFLOW is zero.
+ *
+ * The header's first word lines up with the inode_sector of the
+ * first entry of a linear directory and holds a value that is never
+ * a valid sector number.  That is how directories in the original
+ * linear format, which small directories still use, are told
+ * apart. */
+#define HASHED_MAGIC 0x48444952         /* "HDIR". */
+#define HASHED_MIN_ENTRIES 64
+#define BUCKET_ENTRIES \
+	((DISK_SECTOR_SIZE - 8) / sizeof (struct dir_entry))
+
+/* First sector of a hashed directory. */
+struct dir_header {
+	uint32_t magic;                     /* HASHED_MAGIC. */
+	uint32_t bucket_cnt;                /* Number of buckets. */
+	uint8_t unused[DISK_SECTOR_SIZE - 8];
+};
+
+/* A hash bucket, one sector long. */
+struct dir_bucket {
+	uint16_t used;                      /* Entries in use. */
+	uint16_t free_hint;                 /* No free entry below this. */
+	uint32_t overflow;                  /* Entries homed here, stored later. */
+	struct dir_entry entries[BUCKET_ENTRIES];
+	uint8_t unused[DISK_SECTOR_SIZE - 8
+		- BUCKET_ENTRIES * sizeof (struct dir_entry)];
+};
+
+/* Returns the byte offset of bucket B. */
+static inline off_t
+bucket_ofs (uint32_t b) {
+	return (b + 1) * DISK_SECTOR_SIZE;
+}
+
+/* Returns the home bucket of NAME in DIR. */
+static uint32_t
+home_bucket (const struct dir *dir, const char *name) {
+	return hash_string (name) % dir->bucket_cnt;
+}
+
+/* Reads bucket B of DIR into BUCKET.  Returns true if successful. */
+static bool
+bucket_read (const struct dir *dir, uint32_t b, struct dir_bucket *bucket) {
+	return inode_read_at (dir->inode, bucket, sizeof *bucket, bucket_ofs (b))
+		== sizeof *bucket;
+}
+
+/* Writes BUCKET to bucket B of DIR.  Returns true if successful. */
+static bool
+bucket_write (struct dir *dir, uint32_t b, const struct dir_bucket *bucket) {
+	return inode_write_at (dir->inode, bucket, sizeof *bucket, bucket_ofs (b))
+		== sizeof *bucket;
+}
+
+/* Adds DELTA to the OVERFLOW count of every bucket from FIRST up to,
+ * but not including, LAST.  A count that is too high only makes
+ * lookups probe further, so the journal may commit after any bucket;
+ * that keeps a long run of buckets from overflowing a transaction.
+ * Counts are therefore raised before an entry is added and lowered
+ * after one is erased. */
+static bool
+adjust_overflow (struct dir *dir, uint32_t first, uint32_t last,
+		struct dir_bucket *bucket, int delta) {
+	uint32_t b;
+
+	for (b = first; b != last; b = (b + 1) % dir->bucket_cnt) {
+		if (!bucket_read (dir, b, bucket))
+			return false;
+		bucket->overflow += delta;
+		if (!bucket_write (dir, b, bucket))
+			return false;
+		journal_split ();
+	}
+	return true;
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
- * given SECTOR.  Returns true if successful, false on failure. */
+ * given SECTOR.  Directories for more than HASHED_MIN_ENTRIES
+ * entries are hashed, smaller ones linear.
+ * Returns true if successful, false on failure. */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
-	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+	struct dir_header *header;
+	struct inode *inode;
+	uint32_t bucket_cnt;
+	bool success;
+
+	ASSERT (sizeof (struct dir_header) == DISK_SECTOR_SIZE);
+	ASSERT (sizeof (struct dir_bucket) == DISK_SECTOR_SIZE);
+
+	if (entry_cnt <= HASHED_MIN_ENTRIES)
+		return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+
+	bucket_cnt = DIV_ROUND_UP (entry_cnt, BUCKET_ENTRIES);
+	if (!inode_create (sector, bucket_ofs (bucket_cnt)))
+		return false;
+
+	/* The buckets start out zeroed, that is, empty. */
+	header = calloc (1, sizeof *header);
+	inode = inode_open (sector);
+	success = header != NULL && inode != NULL;
+	if (success) {
+		header->magic = HASHED_MAGIC;
+		header->bucket_cnt = bucket_cnt;
+		success = inode_write_at (inode, header, sizeof *header, 0)
+			== sizeof *header;
+	}
+	inode_close (inode);
+	free (header);
+	return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -32,6 +153,7 @@ struct dir *
 dir_open (struct inode *inode) {
 	struct dir *dir = calloc (1, sizeof *dir);
 	if (inode != NULL && dir != NULL) {
+		inode_set_metadata (inode);
 		dir->inode = inode;
 		dir->pos = 0;
 		return dir;
@@ -65,19 +187,139 @@ dir_close (struct dir *dir) {
 	}
 }
 
+/* Reads DIR's header, unless that has been done already, to tell
+ * whether DIR is hashed.  Deferred until first needed, so that
+ * lookups answered by the directory entry cache read nothing. */
+static void
+probe (struct dir *dir) {
+	uint32_t header[2];
+
+	if (dir->probed)
+		return;
+	if (inode_read_at (dir->inode, header, sizeof header, 0) == sizeof header
+			&& header[0] == HASHED_MAGIC)
+		dir->bucket_cnt = header[1];
+	dir->probed = true;
+}
+
 /* Returns the inode encapsulated by DIR. */
 struct inode *
 dir_get_inode (struct dir *dir) {
 	return dir->inode;
 }
 
+/* Searches hashed directory DIR for NAME, probing from its home
+ * bucket.  Works like lookup(). */
+static bool
+hashed_lookup (const struct dir *dir, const char *name,
+		struct dir_entry *ep, off_t *ofsp) {
+	struct dir_bucket *bucket = malloc (sizeof *bucket);
+	uint32_t b = home_bucket (dir, name);
+	uint32_t n;
+	size_t i;
+	bool found = false;
+
+	if (bucket == NULL)
+		return false;
+
+	for (n = 0; n < dir->bucket_cnt && bucket_read (dir, b, bucket); n++) {
+		for (i = 0; bucket->used > 0 && i < BUCKET_ENTRIES; i++) {
+			struct dir_entry *e = &bucket->entries[i];
+			if (e->in_use && !strcmp (name, e->name)) {
+				if (ep != NULL)
+					*ep = *e;
+				if (ofsp != NULL)
+					*ofsp = bucket_ofs (b) + offsetof (struct dir_bucket, entries)
+						+ i * sizeof *e;
+				found = true;
+				goto done;
+			}
+		}
+		if (bucket->overflow == 0)
+			break;
+		b = (b + 1) % dir->bucket_cnt;
+	}
+
+done:
+	free (bucket);
+	return found;
+}
+
+/* Adds an entry for NAME, which is not yet in hashed directory DIR,
+ * in the first bucket with room from NAME's home bucket on. */
+static bool
+hashed_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
+	struct dir_bucket *bucket = malloc (sizeof *bucket);
+	uint32_t home = home_bucket (dir, name);
+	uint32_t b = home;
+	uint32_t n;
+	bool success = false;
+
+	if (bucket == NULL)
+		return false;
+
+	for (n = 0; n < dir->bucket_cnt && bucket_read (dir, b, bucket); n++) {
+		if (bucket->used < BUCKET_ENTRIES) {
+			struct dir_entry *e;
+			size_t i;
+
+			/* Count the entry in the buckets it passes first. */
+			if (b != home && (!adjust_overflow (dir, home, b, bucket, 1)
+						|| !bucket_read (dir, b, bucket)))
+				break;
+			i = bucket->free_hint;
+			while (bucket->entries[i].in_use)
+				i++;
+			e = &bucket->entries[i];
+			e->in_use = true;
+			strlcpy (e->name, name, sizeof e->name);
+			e->inode_sector = inode_sector;
+			bucket->used++;
+			bucket->free_hint = i + 1;
+			success = bucket_write (dir, b, bucket);
+			break;
+		}
+		b = (b + 1) % dir->bucket_cnt;
+	}
+
+	free (bucket);
+	return success;
+}
+
+/* Erases the entry for NAME at byte offset OFS in hashed directory
+ * DIR. */
+static bool
+hashed_erase (struct dir *dir, const char *name, off_t ofs) {
+	struct dir_bucket *bucket = malloc (sizeof *bucket);
+	uint32_t b = ofs / DISK_SECTOR_SIZE - 1;
+	size_t i = (ofs % DISK_SECTOR_SIZE - offsetof (struct dir_bucket, entries))
+		/ sizeof (struct dir_entry);
+	bool success;
+
+	if (bucket == NULL)
+		return false;
+
+	success = bucket_read (dir, b, bucket);
+	if (success) {
+		bucket->entries[i].in_use = false;
+		bucket->used--;
+		if (i < bucket->free_hint)
+			bucket->free_hint = i;
+		success = (bucket_write (dir, b, bucket)
+				&& adjust_overflow (dir, home_bucket (dir, name), b, bucket, -1));
+	}
+
+	free (bucket);
+	return success;
+}
+
 /* Searches DIR for a file with the given NAME.
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
  * directory entry if OFSP is non-null.
  * otherwise, returns false and ignores EP and OFSP. */
 static bool
-lookup (const struct dir *dir, const char *name,
+lookup (struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
 	struct dir_entry e;
 	size_t ofs;
@@ -85,6 +327,10 @@ lookup (const struct dir *dir, const char *name,
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	probe (dir);
+	if (dir->bucket_cnt > 0)
+		return hashed_lookup (dir, name, ep, ofsp);
+
 	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 			ofs += sizeof e)
 		if (e.in_use && !strcmp (name, e.name)) {
@@ -102,15 +348,21 @@ lookup (const struct dir *dir, const char *name,
  * On success, sets *INODE to an inode for the file, otherwise to
  * a null pointer.  The caller must close *INODE. */
 bool
-dir_lookup (const struct dir *dir, const char *name,
+dir_lookup (struct dir *dir, const char *name,
 		struct inode **inode) {
 	struct dir_entry e;
+	disk_sector_t sector;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
+	if (!dcache_lookup (dir->inode, name, &sector)) {
+		sector = lookup (dir, name, &e, NULL) ? e.inode_sector : DCACHE_NEGATIVE;
+		dcache_insert (dir->inode, name, sector);
+	}
+
+	if (sector != DCACHE_NEGATIVE)
+		*inode = inode_open (sector);
 	else
 		*inode = NULL;
 
@@ -126,6 +378,7 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	struct dir_entry e;
+	disk_sector_t sector;
 	off_t ofs;
 	bool success = false;
 
@@ -137,9 +390,18 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 		return false;
 
 	/* Check that NAME is not in use. */
-	if (lookup (dir, name, NULL, NULL))
+	if (dcache_lookup (dir->inode, name, &sector)) {
+		if (sector != DCACHE_NEGATIVE)
+			goto done;
+	} else if (lookup (dir, name, NULL, NULL))
 		goto done;
 
+	probe (dir);
+	if (dir->bucket_cnt > 0) {
+		success = hashed_add (dir, name, inode_sector);
+		goto done;
+	}
+
 	/* Set OFS to offset of free slot.
 	 * If there are no free slots, then it will be set to the
 	 * current end-of-file.
@@ -159,6 +421,8 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+	if (success)
+		dcache_insert (dir->inode, name, inode_sector);
 	return success;
 }
 
@@ -169,6 +433,7 @@ bool
 dir_remove (struct dir *dir, const char *name) {
 	struct dir_entry e;
 	struct inode *inode = NULL;
+	disk_sector_t sector;
 	bool success = false;
 	off_t ofs;
 
@@ -176,6 +441,9 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (name != NULL);
 
 	/* Find directory entry. */
+	if (dcache_lookup (dir->inode, name, &sector)
+			&& sector == DCACHE_NEGATIVE)
+		goto done;
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
 
@@ -185,12 +453,18 @@ dir_remove (struct dir *dir, const char *name) {
 		goto done;
 
 	/* Erase directory entry. */
-	e.in_use = false;
-	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
-		goto done;
+	if (dir->bucket_cnt > 0) {
+		if (!hashed_erase (dir, name, ofs))
+			goto done;
+	} else {
+		e.in_use = false;
+		if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+			goto done;
+	}
 
 	/* Remove inode. */
 	inode_remove (inode);
+	dcache_insert (dir->inode, name, DCACHE_NEGATIVE);
 	success = true;
 
 done:
@@ -198,6 +472,37 @@ done:
 	return success;
 }
 
+/* Reads the next entry of hashed directory DIR, whose position
+ * counts entry slots across all buckets.  Works like
+ * dir_readdir(). */
+static bool
+hashed_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
+	struct dir_bucket *bucket = malloc (sizeof *bucket);
+	bool found = false;
+
+	if (bucket == NULL)
+		return false;
+
+	while (!found && dir->pos < (off_t) (dir->bucket_cnt * BUCKET_ENTRIES)) {
+		uint32_t b = dir->pos / BUCKET_ENTRIES;
+		size_t i = dir->pos % BUCKET_ENTRIES;
+
+		if (!bucket_read (dir, b, bucket))
+			break;
+		for (; i < BUCKET_ENTRIES && !found; i++) {
+			struct dir_entry *e = &bucket->entries[i];
+			if (e->in_use) {
+				strlcpy (name, e->name, NAME_MAX + 1);
+				found = true;
+			}
+		}
+		dir->pos = b * BUCKET_ENTRIES + i;
+	}
+
+	free (bucket);
+	return found;
+}
+
 /* Reads the next directory entry in DIR and stores the name in
  * NAME.  Returns true if successful, false if the directory
  * contains no more entries. */
@@ -205,6 +510,10 @@ bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	struct dir_entry e;
 
+	probe (dir);
+	if (dir->bucket_cnt > 0)
+		return hashed_readdir (dir, name);
+
 	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
 		dir->pos += sizeof e;
 		if (e.in_use) {
@@ -214,3 +523,70 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	}
 	return false;
 }
+
+/* Reads up to CNT entries of DIR, starting at its position, into
+ * RECORDS and advances the position past them.  Entries are read a
+ * bucket, or as many linear entries as fit in one, at a time, so
+ * each sector of DIR is read once however many entries it holds.
+ * Returns the number of entries read, 0 at the end of DIR. */
+size_t
+dir_getdents (struct dir *dir, struct dir_record *records, size_t cnt) {
+	struct dir_bucket *bucket = malloc (sizeof *bucket);
+	size_t n = 0;
+
+	if (bucket == NULL)
+		return 0;
+
+	probe (dir);
+	while (n < cnt) {
+		size_t i, entry_cnt;
+		off_t step;
+
+		if (dir->bucket_cnt > 0) {
+			uint32_t b = dir->pos / BUCKET_ENTRIES;
+
+			if (b >= dir->bucket_cnt || !bucket_read (dir, b, bucket))
+				break;
+			i = dir->pos % BUCKET_ENTRIES;
+			entry_cnt = BUCKET_ENTRIES;
+			step = 1;
+		} else {
+			off_t size = inode_read_at (dir->inode, bucket->entries,
+					sizeof bucket->entries, dir->pos);
+
+			i = 0;
+			entry_cnt = size / sizeof (struct dir_entry);
+			step = sizeof (struct dir_entry);
+			if (entry_cnt == 0)
+				break;
+		}
+
+		for (; i < entry_cnt && n < cnt; i++) {
+			struct dir_entry *e = &bucket->entries[i];
+
+			dir->pos += step;
+			if (e->in_use) {
+				records[n].inumber = e->inode_sector;
+				records[n].next = dir->pos;
+				strlcpy (records[n].name, e->name, sizeof records[n].name);
+				n++;
+			}
+		}
+	}
+
+	free (bucket);
+	return n;
+}
+
+/* Makes POS, a value returned by dir_tell() or found in a
+ * dir_record, the position of DIR's next read. */
+void
+dir_seek (struct dir *dir, off_t pos) {
+	dir->pos = pos;
+}
+
+/* Returns the position of DIR's next read. */
+off_t
+dir_tell (const struct dir *dir) {
+	return dir->pos;
+}
@@ -1,13 +1,25 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "filesys/directory.h"
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#ifdef VM
+#include "vm/shm.h"
+#endif
 
 /* An open file. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	int ref_cnt;                /* Holders; freed by the last file_close(). */
+	struct pipe *pipe;          /* Pipe this is an end of, or null. */
+	bool pipe_writer;           /* Write end of PIPE? */
+	bool nonblock;              /* Pipe end does not wait? */
+	struct shm_segment *shm;    /* Shared memory segment, or null. */
+	struct dir *dir;            /* Directory, or null. */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +32,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
@@ -28,10 +41,111 @@ file_open (struct inode *inode) {
 	}
 }
 
-/* Opens and returns a new file for the same inode as FILE.
- * Returns a null pointer if unsuccessful. */
+/* Makes FILE, freshly allocated with calloc(), a new end of PIPE and
+ * returns it.  Returns a null pointer if FILE is null. */
+static struct file *
+file_init_pipe_end (struct file *file, struct pipe *pipe, bool writer,
+		bool nonblock) {
+	if (file != NULL) {
+		file->ref_cnt = 1;
+		file->pipe = pipe;
+		file->pipe_writer = writer;
+		file->nonblock = nonblock;
+		pipe_open_end (pipe, writer);
+	}
+	return file;
+}
+
+/* Creates a pipe and stores its read end in ENDS[0] and its write
+ * end in ENDS[1].  If NONBLOCK, neither end waits for the other.
+ * Returns false if memory is short. */
+bool
+file_open_pipe (struct file *ends[2], bool nonblock) {
+	struct file *reader = calloc (1, sizeof *reader);
+	struct file *writer = calloc (1, sizeof *writer);
+	struct pipe *pipe = NULL;
+
+	if (reader != NULL && writer != NULL)
+		pipe = pipe_create ();
+	if (pipe == NULL) {
+		free (reader);
+		free (writer);
+		return false;
+	}
+	ends[0] = file_init_pipe_end (reader, pipe, false, nonblock);
+	ends[1] = file_init_pipe_end (writer, pipe, true, nonblock);
+	return true;
+}
+
+/* Opens a file for directory DIR, of which it takes ownership.
+ * Returns a null pointer if an allocation fails or if DIR is null.
+ * The file can only be read with dir_readdir() and dir_getdents(),
+ * and its position is DIR's. */
+struct file *
+file_open_dir (struct dir *dir) {
+	struct file *file = calloc (1, sizeof *file);
+	if (dir != NULL && file != NULL) {
+		file->ref_cnt = 1;
+		file->dir = dir;
+		return file;
+	} else {
+		dir_close (dir);
+		free (file);
+		return NULL;
+	}
+}
+
+/* Returns the directory FILE was opened for, or a null pointer. */
+struct dir *
+file_get_dir (struct file *file) {
+	return file->dir;
+}
+
+#ifdef VM
+/* Opens a file for shared memory segment SEG, taking over the caller's
+ * reference to SEG.  Returns a null pointer, closing SEG, if memory is
+ * short.  The file can only be mapped with mmap(). */
+struct file *
+file_open_shm (struct shm_segment *seg) {
+	struct file *file = calloc (1, sizeof *file);
+	if (file == NULL) {
+		shm_segment_close (seg);
+		return NULL;
+	}
+	file->ref_cnt = 1;
+	file->shm = seg;
+	return file;
+}
+
+/* Returns the shared memory segment FILE was opened for, or a null
+ * pointer. */
+struct shm_segment *
+file_get_shm (struct file *file) {
+	return file->shm;
+}
+#endif
+
+/* Returns true if FILE is an end of a pipe. */
+bool
+file_is_pipe (struct file *file) {
+	return file->pipe != NULL;
+}
+
+/* Opens and returns a new file for the same inode as FILE, or a new
+ * end of the same pipe.  Returns a null pointer if unsuccessful. */
 struct file *
 file_reopen (struct file *file) {
+	if (file->pipe != NULL)
+		return file_init_pipe_end (calloc (1, sizeof *file), file->pipe,
+				file->pipe_writer, file->nonblock);
+#ifdef VM
+	if (file->shm != NULL) {
+		shm_segment_reopen (file->shm);
+		return file_open_shm (file->shm);
+	}
+#endif
+	if (file->dir != NULL)
+		return file_open_dir (dir_reopen (file->dir));
 	return file_open (inode_reopen (file->inode));
 }
 
@@ -39,6 +153,15 @@ file_reopen (struct file *file) {
  * same inode as FILE. Returns a null pointer if unsuccessful. */
 struct file *
 file_duplicate (struct file *file) {
+	if (file->dir != NULL) {
+		struct file *nfile = file_reopen (file);
+		if (nfile)
+			dir_seek (nfile->dir, dir_tell (file->dir));
+		return nfile;
+	}
+	if (file->inode == NULL)
+		return file_reopen (file);
+
 	struct file *nfile = file_open (inode_reopen (file->inode));
 	if (nfile) {
 		nfile->pos = file->pos;
@@ -48,10 +171,51 @@ file_duplicate (struct file *file) {
 	return nfile;
 }
 
-/* Closes FILE. */
+/* Takes another reference to FILE, which then stays open until
+ * file_close() is called once for every reference.  All references
+ * share one position.  Returns FILE.  References may be dropped from
+ * other threads, such as the asynchronous I/O workers, so the count
+ * is updated with interrupts off. */
+struct file *
+file_ref (struct file *file) {
+	enum intr_level old_level = intr_disable ();
+	file->ref_cnt++;
+	intr_set_level (old_level);
+	return file;
+}
+
+/* Returns the number of references to FILE. */
+int
+file_ref_cnt (struct file *file) {
+	return file->ref_cnt;
+}
+
+/* Drops a reference to FILE, closing it with the last one. */
 void
 file_close (struct file *file) {
 	if (file != NULL) {
+		enum intr_level old_level = intr_disable ();
+		bool last = --file->ref_cnt == 0;
+		intr_set_level (old_level);
+		if (!last)
+			return;
+		if (file->pipe != NULL) {
+			pipe_close_end (file->pipe, file->pipe_writer);
+			free (file);
+			return;
+		}
+#ifdef VM
+		if (file->shm != NULL) {
+			shm_segment_close (file->shm);
+			free (file);
+			return;
+		}
+#endif
+		if (file->dir != NULL) {
+			dir_close (file->dir);
+			free (file);
+			return;
+		}
 		file_allow_write (file);
 		inode_close (file->inode);
 		free (file);
@@ -71,6 +235,12 @@ file_get_inode (struct file *file) {
  * Advances FILE's position by the number of bytes read. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
+	if (file->pipe != NULL)
+		return file->pipe_writer ? -1
+			: pipe_read (file->pipe, buffer, size, file->nonblock);
+	if (file->inode == NULL)
+		return -1;
+
 	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_read;
 	return bytes_read;
@@ -83,18 +253,25 @@ file_read (struct file *file, void *buffer, off_t size) {
  * The file's current position is unaffected. */
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
+	if (file->inode == NULL)
+		return -1;
 	return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at the file's current position.
+ * A write that ends past end of file grows the file.
  * Returns the number of bytes actually written,
- * which may be less than SIZE if end of file is reached.
- * (Normally we'd grow the file in that case, but file growth is
- * not yet implemented.)
+ * which may be less than SIZE if the disk is full.
  * Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) {
+	if (file->pipe != NULL)
+		return file->pipe_writer
+			? pipe_write (file->pipe, buffer, size, file->nonblock) : -1;
+	if (file->inode == NULL)
+		return -1;
+
 	off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_written;
 	return bytes_written;
@@ -102,14 +279,15 @@ file_write (struct file *file, const void *buffer, off_t size) {
 
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at offset FILE_OFS in the file.
+ * A write that ends past end of file grows the file.
  * Returns the number of bytes actually written,
- * which may be less than SIZE if end of file is reached.
- * (Normally we'd grow the file in that case, but file growth is
- * not yet implemented.)
+ * which may be less than SIZE if the disk is full.
  * The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
 		off_t file_ofs) {
+	if (file->inode == NULL)
+		return -1;
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
@@ -118,7 +296,7 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 void
 file_deny_write (struct file *file) {
 	ASSERT (file != NULL);
-	if (!file->deny_write) {
+	if (!file->deny_write && file->inode != NULL) {
 		file->deny_write = true;
 		inode_deny_write (file->inode);
 	}
@@ -140,6 +318,12 @@ file_allow_write (struct file *file) {
 off_t
 file_length (struct file *file) {
 	ASSERT (file != NULL);
+#ifdef VM
+	if (file->shm != NULL)
+		return shm_segment_size (file->shm);
+#endif
+	if (file->inode == NULL)
+		return 0;
 	return inode_length (file->inode);
 }
 
@@ -149,7 +333,10 @@ void
 file_seek (struct file *file, off_t new_pos) {
 	ASSERT (file != NULL);
 	ASSERT (new_pos >= 0);
-	file->pos = new_pos;
+	if (file->dir != NULL)
+		dir_seek (file->dir, new_pos);
+	else if (file->inode != NULL)
+		file->pos = new_pos;
 }
 
 /* Returns the current position in FILE as a byte offset from the
@@ -157,5 +344,7 @@ file_seek (struct file *file, off_t new_pos) {
 off_t
 file_tell (struct file *file) {
 	ASSERT (file != NULL);
+	if (file->dir != NULL)
+		return dir_tell (file->dir);
 	return file->pos;
 }
@@ -3,14 +3,29 @@
 #include <stdio.h>
 #include <string.h>
 #include "filesys/file.h"
+#include "filesys/dcache.h"
+#include "filesys/defrag.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
+/* Sectors per chunk when striping the file system across hd0:1
+ * and hd1:1, or 0 to use hd0:1 alone. */
+unsigned filesys_stripe_chunk;
+
+/* Sectors at the start of hd1:1 taken by a striped file system. */
+disk_sector_t filesys_swap_start;
+
+/* Number of entries the root directory is formatted for.  This is
+ * enough to make it a hashed directory. */
+#define ROOT_DIR_ENTRIES 8192
+
+static void stripe_filesys_disk (void);
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -20,8 +35,11 @@ filesys_init (bool format) {
 	filesys_disk = disk_get (0, 1);
 	if (filesys_disk == NULL)
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
+	if (filesys_stripe_chunk > 0)
+		stripe_filesys_disk ();
 
 	inode_init ();
+	dcache_init ();
 
 #ifdef EFILESYS
 	fat_init ();
@@ -37,10 +55,39 @@ filesys_init (bool format) {
 	if (format)
 		do_format ();
 
+	journal_init ();
 	free_map_open ();
+	defrag_init ();
 #endif
 }
 
+/* Replaces filesys_disk by a volume striped across it and hd1:1,
+ * which sits on the other channel, so that large transfers keep
+ * both channels busy.  The volume takes as much of hd1:1 as there is
+ * of hd0:1, and swap gets the rest, so with VM hd1:1 has to be the
+ * larger. */
+static void
+stripe_filesys_disk (void) {
+	struct disk *members[2];
+
+	members[0] = filesys_disk;
+	members[1] = disk_get (1, 1);
+	if (members[1] == NULL)
+		PANIC ("hd1:1 (hdd) not present, can't stripe the file system");
+#ifdef VM
+	if (disk_size (members[1]) <= disk_size (members[0])) {
+		printf ("filesys: -stripe needs hd1:1 larger than hd0:1, "
+				"to leave room for swap, not striping\n");
+		filesys_stripe_chunk = 0;
+		return;
+	}
+#endif
+	filesys_disk = disk_stripe (members, 2, filesys_stripe_chunk);
+	if (filesys_disk == NULL)
+		PANIC ("striped volume creation failed");
+	filesys_swap_start = disk_size (filesys_disk) / 2;
+}
+
 /* Shuts down the file system module, writing any unwritten data
  * to disk. */
 void
@@ -49,10 +96,31 @@ filesys_done (void) {
 #ifdef EFILESYS
 	fat_close ();
 #else
+	inode_sync ();
+	/* Commit, so that the sectors freed so far reach the free map
+	 * before it is closed. */
+	journal_sync ();
 	free_map_close ();
+	journal_done ();
 #endif
 }
 
+/* Prints file system statistics. */
+void
+filesys_print_stats (void) {
+	dcache_print_stats ();
+	inode_print_stats ();
+	journal_print_stats ();
+	defrag_print_stats ();
+}
+
+/* Makes every file system update made so far durable. */
+void
+filesys_sync (void) {
+	inode_sync ();
+	journal_sync ();
+}
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
  * Returns true if successful, false otherwise.
  * Fails if a file named NAME already exists,
@@ -60,19 +128,27 @@ filesys_done (void) {
 bool
 filesys_create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
-	struct dir *dir = dir_open_root ();
-	bool success = (dir != NULL
-			&& free_map_allocate (1, &inode_sector)
+	struct dir *dir;
+	bool success;
+
+	journal_begin ();
+	dir = dir_open_root ();
+	success = (dir != NULL
+			&& free_map_allocate_near (1,
+				free_map_inode_goal (inode_get_inumber (dir_get_inode (dir))),
+				&inode_sector)
 			&& inode_create (inode_sector, initial_size)
 			&& dir_add (dir, name, inode_sector));
 	if (!success && inode_sector != 0)
 		free_map_release (inode_sector, 1);
 	dir_close (dir);
+	journal_end ();
 
 	return success;
 }
 
-/* Opens the file with the given NAME.
+/* Opens the file with the given NAME, or the root directory if
+ * NAME is "/".
  * Returns the new file if successful or a null pointer
  * otherwise.
  * Fails if no file named NAME exists,
@@ -82,6 +158,8 @@ filesys_open (const char *name) {
 	struct dir *dir = dir_open_root ();
 	struct inode *inode = NULL;
 
+	if (!strcmp (name, "/"))
+		return file_open_dir (dir);
 	if (dir != NULL)
 		dir_lookup (dir, name, &inode);
 	dir_close (dir);
@@ -95,9 +173,14 @@ filesys_open (const char *name) {
  * or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) {
-	struct dir *dir = dir_open_root ();
-	bool success = dir != NULL && dir_remove (dir, name);
+	struct dir *dir;
+	bool success;
+
+	journal_begin ();
+	dir = dir_open_root ();
+	success = dir != NULL && dir_remove (dir, name);
 	dir_close (dir);
+	journal_end ();
 
 	return success;
 }
@@ -113,8 +196,9 @@ do_format (void) {
 	fat_close ();
 #else
 	free_map_create ();
-	if (!dir_create (ROOT_DIR_SECTOR, 16))
+	if (!dir_create (ROOT_DIR_SECTOR, ROOT_DIR_ENTRIES))
 		PANIC ("root directory creation failed");
+	journal_create ();
 	free_map_close ();
 #endif
 
@@ -1,13 +1,65 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
 
+/* Protects free_map, group_free and writes to free_map_file.  Sectors
+ * are allocated and freed by syscalls under filesys_lock, but also by
+ * inode_close() from paths that do not hold it, such as process exit,
+ * and by journald releasing committed frees. */
+static struct lock free_map_lock;
+
+/* Block groups.
+ *
+ * The disk is divided into groups of GROUP_SECTORS sectors, and the
+ * number of free sectors in each is kept up to date.  Allocations
+ * take a goal sector and search from it, so that a file's data lands
+ * right after its inode and an inode next to its directory.  A new
+ * inode goes to another group once its directory's group runs low on
+ * space, leaving room there for the data of files already in it. */
+#define GROUP_SECTORS 2048
+#define GROUP_RESERVE (GROUP_SECTORS / 8)
+
+static size_t *group_free;           /* Free sectors in each group. */
+static size_t group_cnt;             /* Number of groups. */
+
+/* Adds DELTA to the free counts of the groups that sectors
+ * SECTOR...SECTOR + CNT - 1 fall in. */
+static void
+count_free (disk_sector_t sector, size_t cnt, int delta) {
+	while (cnt > 0) {
+		size_t group = sector / GROUP_SECTORS;
+		size_t run = (group + 1) * GROUP_SECTORS - sector;
+		if (run > cnt)
+			run = cnt;
+		group_free[group] += delta * (int) run;
+		sector += run;
+		cnt -= run;
+	}
+}
+
+/* Recomputes every group's free count from the free map. */
+static void
+count_groups (void) {
+	size_t size = bitmap_size (free_map);
+	size_t g;
+
+	for (g = 0; g < group_cnt; g++) {
+		size_t start = g * GROUP_SECTORS;
+		size_t cnt = size - start < GROUP_SECTORS ? size - start : GROUP_SECTORS;
+		group_free[g] = bitmap_count (free_map, start, cnt, false);
+	}
+}
+
 /* Initializes the free map. */
 void
 free_map_init (void) {
@@ -16,6 +68,28 @@ free_map_init (void) {
 		PANIC ("bitmap creation failed--disk is too large");
 	bitmap_mark (free_map, FREE_MAP_SECTOR);
 	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	bitmap_mark (free_map, JOURNAL_SECTOR);
+	lock_init (&free_map_lock);
+
+	group_cnt = DIV_ROUND_UP (bitmap_size (free_map), GROUP_SECTORS);
+	group_free = calloc (group_cnt, sizeof *group_free);
+	if (group_free == NULL)
+		PANIC ("block group creation failed");
+	count_groups ();
+}
+
+/* Marks the CNT sectors starting at SECTOR, which must be free, as
+ * used and writes the free map.  Returns true if successful.  Must be
+ * called with free_map_lock held. */
+static bool
+take (disk_sector_t sector, size_t cnt) {
+	bitmap_set_multiple (free_map, sector, cnt, true);
+	if (free_map_file != NULL && !bitmap_write (free_map, free_map_file)) {
+		bitmap_set_multiple (free_map, sector, cnt, false);
+		return false;
+	}
+	count_free (sector, cnt, -1);
+	return true;
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -24,24 +98,113 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-	if (sector != BITMAP_ERROR
-			&& free_map_file != NULL
-			&& !bitmap_write (free_map, free_map_file)) {
-		bitmap_set_multiple (free_map, sector, cnt, false);
-		sector = BITMAP_ERROR;
-	}
-	if (sector != BITMAP_ERROR)
+	return free_map_allocate_near (cnt, 0, sectorp);
+}
+
+/* Like free_map_allocate(), but takes the first run of CNT free
+ * sectors at or after GOAL, wrapping around to the start of the
+ * disk if there is none. */
+bool
+free_map_allocate_near (size_t cnt, disk_sector_t goal,
+		disk_sector_t *sectorp) {
+	disk_sector_t sector;
+	bool success;
+
+	if (goal >= bitmap_size (free_map))
+		goal = 0;
+	lock_acquire (&free_map_lock);
+	sector = bitmap_scan (free_map, goal, cnt, false);
+	if (sector == BITMAP_ERROR && goal > 0)
+		sector = bitmap_scan (free_map, 0, cnt, false);
+	success = sector != BITMAP_ERROR && take (sector, cnt);
+	lock_release (&free_map_lock);
+	if (success)
 		*sectorp = sector;
-	return sector != BITMAP_ERROR;
+	return success;
+}
+
+/* Allocates exactly the CNT sectors starting at SECTOR, if all of
+ * them are free.  Returns true if successful. */
+bool
+free_map_allocate_at (disk_sector_t sector, size_t cnt) {
+	bool success;
+
+	if (sector + cnt > bitmap_size (free_map))
+		return false;
+	lock_acquire (&free_map_lock);
+	success = bitmap_none (free_map, sector, cnt) && take (sector, cnt);
+	lock_release (&free_map_lock);
+	return success;
+}
+
+/* Returns a goal sector for a new inode in the directory whose
+ * inode is at DIR_SECTOR: DIR_SECTOR itself if its group still has
+ * room, otherwise the start of the group with the most free
+ * sectors. */
+disk_sector_t
+free_map_inode_goal (disk_sector_t dir_sector) {
+	size_t g, best;
+	disk_sector_t goal = dir_sector;
+
+	lock_acquire (&free_map_lock);
+	if (group_free[dir_sector / GROUP_SECTORS] < GROUP_RESERVE) {
+		for (best = g = 0; g < group_cnt; g++)
+			if (group_free[g] > group_free[best])
+				best = g;
+		goal = best * GROUP_SECTORS;
+	}
+	lock_release (&free_map_lock);
+	return goal;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR available for use, once the
+ * journal has committed the operation that freed them. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
+	lock_acquire (&free_map_lock);
+	ASSERT (bitmap_all (free_map, sector, cnt));
+	lock_release (&free_map_lock);
+	if (!journal_release (sector, cnt))
+		free_map_release_now (sector, cnt);
+}
+
+/* Makes CNT sectors starting at SECTOR available for use right away
+ * and writes the free map. */
+void
+free_map_release_now (disk_sector_t sector, size_t cnt) {
+	lock_acquire (&free_map_lock);
 	ASSERT (bitmap_all (free_map, sector, cnt));
 	bitmap_set_multiple (free_map, sector, cnt, false);
-	bitmap_write (free_map, free_map_file);
+	count_free (sector, cnt, 1);
+	if (free_map_file != NULL)
+		bitmap_write (free_map, free_map_file);
+	lock_release (&free_map_lock);
+}
+
+/* Returns the length of the longest run of free sectors and stores
+ * the number of such runs in *RUN_CNT. */
+size_t
+free_map_free_runs (size_t *run_cnt) {
+	size_t size = free_map != NULL ? bitmap_size (free_map) : 0;
+	size_t longest = 0, run = 0;
+	size_t i;
+
+	*run_cnt = 0;
+	if (free_map != NULL)
+		lock_acquire (&free_map_lock);
+	for (i = 0; i < size; i++) {
+		if (bitmap_test (free_map, i)) {
+			run = 0;
+			continue;
+		}
+		if (run++ == 0)
+			(*run_cnt)++;
+		if (run > longest)
+			longest = run;
+	}
+	if (free_map != NULL)
+		lock_release (&free_map_lock);
+	return longest;
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -50,14 +213,22 @@ free_map_open (void) {
 	free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
 	if (free_map_file == NULL)
 		PANIC ("can't open free map");
+	inode_set_metadata (file_get_inode (free_map_file));
 	if (!bitmap_read (free_map, free_map_file))
 		PANIC ("can't read free map");
+	count_groups ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) {
-	file_close (free_map_file);
+	struct file *file;
+
+	lock_acquire (&free_map_lock);
+	file = free_map_file;
+	free_map_file = NULL;
+	lock_release (&free_map_lock);
+	file_close (file);
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -1,22 +1,36 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Bytes of data an inode sector can hold itself. */
+#define INLINE_MAX (DISK_SECTOR_SIZE - 5 * sizeof (uint32_t))
+
+/* Inode flags. */
+#define INODE_INLINE 0x1                /* Data is in INLINE_DATA. */
+
 /* On-disk inode.
- * Must be exactly DISK_SECTOR_SIZE bytes long. */
+ * Must be exactly DISK_SECTOR_SIZE bytes long.
+ * A file no longer than INLINE_MAX bytes keeps its data in the inode
+ * sector itself and has no data sectors. */
 struct inode_disk {
 	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[125];               /* Not used. */
+	uint32_t sector_cnt;                /* Data sectors allocated. */
+	uint32_t flags;                     /* INODE_* flags. */
+	uint8_t inline_data[INLINE_MAX];    /* Data of an inline file. */
 };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -26,16 +40,40 @@ bytes_to_sectors (off_t size) {
 	return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* Minimum number of sectors reserved past the end of a file that
+ * grows, so that appends keep its data contiguous. */
+#define PREALLOC_SECTORS 64
+
+/* Most bytes of appended data an inode holds in memory before it
+ * allocates sectors for them. */
+#define DELAY_BYTES (16 * DISK_SECTOR_SIZE)
+
+/* In-memory inode.
+ * Keeps only the fields of the on-disk inode that are used after
+ * opening, not the whole sector, except for an inline file, whose
+ * data is in that sector. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	struct hash_elem elem;              /* Element in open_inodes. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
-	struct inode_disk data;             /* Inode content. */
+	disk_sector_t start;                /* First data sector. */
+	off_t length;                       /* File size in bytes. */
+	size_t sector_cnt;                  /* Data sectors allocated. */
+	bool metadata;                      /* Journal writes to the data? */
+	struct inode_disk *inline_disk;     /* Inode sector, if inline. */
+	off_t disk_length;                  /* Bytes of data on disk. */
+	uint8_t *delayed;                   /* Bytes past DISK_LENGTH. */
+	struct lock delayed_lock;           /* Protects DELAYED and LENGTH. */
 };
 
+/* Statistics. */
+static long long extend_cnt, relocate_cnt, spill_cnt;
+static long long delayed_cnt, writeback_cnt;
+
+static void writeback (struct inode *);
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
@@ -43,20 +81,36 @@ struct inode {
 static disk_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
+	if (pos < inode->length)
+		return inode->start + pos / DISK_SECTOR_SIZE;
 	else
 		return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, hashed by sector, so that opening a single inode
+ * twice returns the same `struct inode'. */
+static struct hash open_inodes;
+
+/* Protects open_inodes and every inode's open_cnt. */
+static struct lock open_inodes_lock;
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return (hash_entry (a, struct inode, elem)->sector
+			< hash_entry (b, struct inode, elem)->sector);
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	hash_init (&open_inodes, inode_hash, inode_less, NULL);
+	lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -76,23 +130,31 @@ inode_create (disk_sector_t sector, off_t length) {
 	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
 
 	disk_inode = calloc (1, sizeof *disk_inode);
-	if (disk_inode != NULL) {
+	if (disk_inode != NULL && length <= (off_t) INLINE_MAX) {
+		/* Small enough to live in the inode sector. */
+		disk_inode->length = length;
+		disk_inode->magic = INODE_MAGIC;
+		disk_inode->flags = INODE_INLINE;
+		journal_write (sector, disk_inode, true);
+		success = true;
+	} else if (disk_inode != NULL) {
 		size_t sectors = bytes_to_sectors (length);
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
+		disk_inode->sector_cnt = sectors;
+		if (free_map_allocate_near (sectors, sector + 1, &disk_inode->start)) {
+			journal_write (sector, disk_inode, true);
 			if (sectors > 0) {
 				static char zeros[DISK_SECTOR_SIZE];
 				size_t i;
 
 				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
+					journal_write (disk_inode->start + i, zeros, false); 
 			}
 			success = true; 
 		} 
-		free (disk_inode);
 	}
+	free (disk_inode);
 	return success;
 }
 
@@ -101,48 +163,329 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
+	struct inode key;
+	struct hash_elem *e;
 	struct inode *inode;
+	struct inode_disk *data;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	key.sector = sector;
+	lock_acquire (&open_inodes_lock);
+	e = hash_find (&open_inodes, &key.elem);
+	if (e != NULL) {
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+		return inode;
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	data = malloc (sizeof *data);
+	if (inode == NULL || data == NULL) {
+		lock_release (&open_inodes_lock);
+		free (inode);
+		free (data);
 		return NULL;
+	}
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  The lock stays held across the read so that no
+	 * other opener finds the inode half filled in. */
 	inode->sector = sector;
+	hash_insert (&open_inodes, &inode->elem);
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	inode->metadata = false;
+	inode->inline_disk = NULL;
+	inode->delayed = NULL;
+	lock_init (&inode->delayed_lock);
+	journal_read (inode->sector, data);
+	inode->start = data->start;
+	inode->length = inode->disk_length = data->length;
+	inode->sector_cnt = data->sector_cnt;
+	if (data->flags & INODE_INLINE) {
+		inode->sector_cnt = 0;
+		inode->inline_disk = data;
+	} else if (inode->sector_cnt < bytes_to_sectors (inode->length))
+		inode->sector_cnt = bytes_to_sectors (inode->length);
+	lock_release (&open_inodes_lock);
+	if (inode->inline_disk == NULL)
+		free (data);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
+/* Marks INODE as holding file system metadata, such as a directory,
+ * so that writes to its data go through the journal. */
+void
+inode_set_metadata (struct inode *inode) {
+	inode->metadata = true;
+}
+
+/* Returns the disk sector holding byte offset POS of INODE, or -1 if
+ * POS is past end of file. */
+disk_sector_t
+inode_byte_to_sector (const struct inode *inode, off_t pos) {
+	if (inode->inline_disk != NULL)
+		return -1;
+	return byte_to_sector (inode, pos);
+}
+
 /* Returns INODE's inode number. */
 disk_sector_t
 inode_get_inumber (const struct inode *inode) {
 	return inode->sector;
 }
 
+/* Writes INODE's on-disk inode. */
+static void
+write_disk_inode (const struct inode *inode) {
+	struct inode_disk *data = inode->inline_disk;
+
+	if (data != NULL) {
+		data->length = inode->disk_length;
+		journal_write (inode->sector, data, true);
+		return;
+	}
+
+	data = calloc (1, sizeof *data);
+	if (data == NULL)
+		return;
+	data->start = inode->start;
+	data->length = inode->disk_length;
+	data->magic = INODE_MAGIC;
+	data->sector_cnt = inode->sector_cnt;
+	journal_write (inode->sector, data, true);
+	free (data);
+}
+
+/* Moves the data of inline INODE out of its inode sector into a new
+ * run of sectors near it, big enough for USED sectors and
+ * preferably PREALLOC_SECTORS.
+ * Returns true if successful, false if the disk is full. */
+static bool
+spill (struct inode *inode, size_t used) {
+	size_t cnt = used < PREALLOC_SECTORS ? PREALLOC_SECTORS : used;
+	uint8_t *buffer;
+	disk_sector_t start;
+
+	buffer = calloc (1, DISK_SECTOR_SIZE);
+	if (buffer == NULL)
+		return false;
+	if (!free_map_allocate_near (cnt, inode->sector + 1, &start)) {
+		cnt = used;
+		if (!free_map_allocate_near (cnt, inode->sector + 1, &start)) {
+			free (buffer);
+			return false;
+		}
+	}
+
+	if (inode->disk_length > 0) {
+		memcpy (buffer, inode->inline_disk->inline_data, inode->disk_length);
+		journal_write (start, buffer, inode->metadata);
+	}
+	free (buffer);
+	free (inode->inline_disk);
+	inode->inline_disk = NULL;
+	inode->start = start;
+	inode->sector_cnt = cnt;
+	spill_cnt++;
+	return true;
+}
+
+/* Releases the sectors INODE has preallocated past its end. */
+static void
+trim (struct inode *inode) {
+	size_t used = bytes_to_sectors (inode->disk_length);
+
+	if (inode->sector_cnt > used) {
+		free_map_release (inode->start + used, inode->sector_cnt - used);
+		inode->sector_cnt = used;
+		write_disk_inode (inode);
+	}
+}
+
+/* Copies INODE's data to the CNT sectors already allocated at
+ * START, releases its old sectors and makes START its run.
+ * Returns true if successful, false if memory runs out, in which
+ * case the sectors at START are released instead. */
+static bool
+move (struct inode *inode, disk_sector_t start, size_t cnt) {
+	size_t used = bytes_to_sectors (inode->disk_length);
+	uint8_t *buffer;
+	size_t i;
+
+	buffer = malloc (DISK_SECTOR_SIZE);
+	if (buffer == NULL) {
+		free_map_release (start, cnt);
+		return false;
+	}
+	for (i = 0; i < used; i++) {
+		journal_read (inode->start + i, buffer);
+		journal_write (start + i, buffer, inode->metadata);
+	}
+	free (buffer);
+
+	if (inode->sector_cnt > 0)
+		free_map_release (inode->start, inode->sector_cnt);
+	inode->start = start;
+	inode->sector_cnt = cnt;
+	return true;
+}
+
+/* Moves INODE's data to a new run of CNT sectors near the inode.
+ * Returns true if successful, false if there is no such run. */
+static bool
+relocate (struct inode *inode, size_t cnt) {
+	disk_sector_t start;
+
+	if (!free_map_allocate_near (cnt, inode->sector + 1, &start)
+			|| !move (inode, start, cnt))
+		return false;
+	if (inode->disk_length > 0)
+		relocate_cnt++;
+	return true;
+}
+
+/* Returns how far the data of INODE starting at START would be
+ * from the inode, in sectors. */
+static size_t
+distance (const struct inode *inode, disk_sector_t start) {
+	disk_sector_t goal = inode->sector + 1;
+	return start > goal ? start - goal : goal - start;
+}
+
+/* Returns how far INODE's data is from the inode, in sectors, or 0
+ * if it has none. */
+size_t
+inode_data_distance (const struct inode *inode) {
+	if (inode->sector_cnt == 0)
+		return 0;
+	return distance (inode, inode->start);
+}
+
+/* Moves INODE's data to a free run closer to the inode, if there is
+ * one, so that reading the file after its inode seeks less.  The
+ * move is journaled with the inode.  Metadata files are left alone.
+ *
+ * Page faults read mapped files and executables without
+ * filesys_lock, through references of their own, so a file that
+ * anyone but the caller has open is left alone too.  The caller
+ * must hold filesys_lock, without which no new reference can be
+ * taken while the data moves.
+ * Returns the number of sectors moved. */
+size_t
+inode_defrag (struct inode *inode) {
+	size_t cnt = inode->sector_cnt;
+	disk_sector_t start;
+	bool shared;
+
+	if (inode->metadata || cnt == 0 || inode->start == inode->sector + 1)
+		return 0;
+	lock_acquire (&open_inodes_lock);
+	shared = inode->open_cnt > 1;
+	lock_release (&open_inodes_lock);
+	if (shared)
+		return 0;
+	if (!free_map_allocate_near (cnt, inode->sector + 1, &start))
+		return 0;
+	if (distance (inode, start) >= distance (inode, inode->start)) {
+		free_map_release (start, cnt);
+		return 0;
+	}
+	if (!move (inode, start, cnt))
+		return 0;
+	write_disk_inode (inode);
+	return bytes_to_sectors (inode->disk_length);
+}
+
+/* Makes sure INODE has sectors allocated for LENGTH bytes of data,
+ * without changing its length.
+ *
+ * Data stays in one run of sectors.  If the run has to get longer,
+ * it is extended in place when the sectors after it are free and
+ * otherwise moved to a new run near the inode.  Either way the run
+ * grows by at least its own length, and by no less than
+ * PREALLOC_SECTORS, so that a file being appended to grows in a few
+ * large steps; only if that much space cannot be found does it grow
+ * by just what is needed.  The spare sectors are given back when
+ * the last opener closes the file.
+ * Returns true if successful, false if the disk is full. */
+static bool
+reserve (struct inode *inode, off_t length) {
+	size_t used = bytes_to_sectors (length);
+
+	/* An inline file stays inline while it fits. */
+	if (inode->inline_disk != NULL) {
+		if (length <= (off_t) INLINE_MAX)
+			return true;
+		if (!spill (inode, used))
+			return false;
+	}
+
+	if (used > inode->sector_cnt) {
+		disk_sector_t end = inode->start + inode->sector_cnt;
+		size_t need = used - inode->sector_cnt;
+		size_t grow = need;
+
+		if (grow < inode->sector_cnt)
+			grow = inode->sector_cnt;
+		if (grow < PREALLOC_SECTORS)
+			grow = PREALLOC_SECTORS;
+
+		if (free_map_allocate_at (end, grow)) {
+			inode->sector_cnt += grow;
+			extend_cnt++;
+		} else if (free_map_allocate_at (end, need)) {
+			inode->sector_cnt += need;
+			extend_cnt++;
+		} else if (!relocate (inode, inode->sector_cnt + grow)
+				&& !relocate (inode, used))
+			return false;
+	}
+	return true;
+}
+
+/* Grows INODE so that a write of SIZE bytes at OFFSET fits.  New
+ * sectors the write does not fully cover are zeroed; the bytes of an
+ * inline file past end of file are already zero.
+ * Returns true if successful, false if the disk is full. */
+static bool
+extend (struct inode *inode, off_t offset, off_t size) {
+	static char zeros[DISK_SECTOR_SIZE];
+	off_t length = offset + size;
+	size_t old_used = bytes_to_sectors (inode->length);
+	size_t used = bytes_to_sectors (length);
+	size_t i;
+
+	if (!reserve (inode, length))
+		return false;
+	if (inode->inline_disk != NULL) {
+		inode->length = inode->disk_length = length;
+		return true;
+	}
+
+	for (i = old_used; i < used; i++) {
+		off_t sector_start = i * DISK_SECTOR_SIZE;
+		if (sector_start < offset || sector_start + DISK_SECTOR_SIZE > length)
+			journal_write (inode->start + i, zeros, inode->metadata);
+	}
+	inode->length = inode->disk_length = length;
+	write_disk_inode (inode);
+	return true;
+}
+
 /* Closes INODE and writes it to disk.
  * If this was the last reference to INODE, frees its memory.
  * If INODE was also a removed inode, frees its blocks. */
@@ -153,19 +496,33 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
+	lock_acquire (&open_inodes_lock);
 	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
+		/* Remove from open_inodes and release lock. */
+		hash_delete (&open_inodes, &inode->elem);
+		lock_release (&open_inodes_lock);
 
 		/* Deallocate blocks if removed. */
+		journal_begin ();
 		if (inode->removed) {
+			if (inode->metadata)
+				dcache_forget (inode->sector);
 			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
+			if (inode->sector_cnt > 0)
+				free_map_release (inode->start, inode->sector_cnt);
+		} else {
+			lock_acquire (&inode->delayed_lock);
+			writeback (inode);
+			lock_release (&inode->delayed_lock);
+			trim (inode);
 		}
+		journal_end ();
 
+		free (inode->delayed);
+		free (inode->inline_disk);
 		free (inode); 
-	}
+	} else
+		lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -183,8 +540,47 @@ off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
+	off_t delayed_read = 0;
 	uint8_t *bounce = NULL;
 
+	/* Copy out the part of the range that is still in memory, and
+	 * read only the rest from disk.  Page faults read files without
+	 * filesys_lock, so the delayed data could be written back and
+	 * freed under us: copy it out under delayed_lock, into a kernel
+	 * buffer first because BUFFER may itself fault. */
+	lock_acquire (&inode->delayed_lock);
+	if (inode->delayed != NULL && offset + size > inode->disk_length) {
+		off_t start = offset > inode->disk_length ? offset : inode->disk_length;
+		off_t end = offset + size < inode->length ? offset + size : inode->length;
+
+		if (end > start) {
+			bounce = malloc (end - start);
+			if (bounce == NULL) {
+				lock_release (&inode->delayed_lock);
+				return 0;
+			}
+			delayed_read = end - start;
+			memcpy (bounce, inode->delayed + (start - inode->disk_length),
+					delayed_read);
+		}
+		size = start - offset;
+	}
+	lock_release (&inode->delayed_lock);
+	if (bounce != NULL) {
+		memcpy (buffer + size, bounce, delayed_read);
+		free (bounce);
+		bounce = NULL;
+	}
+
+	if (inode->inline_disk != NULL) {
+		if (offset >= inode->disk_length)
+			return delayed_read;
+		if (size > inode->disk_length - offset)
+			size = inode->disk_length - offset;
+		memcpy (buffer, inode->inline_disk->inline_data + offset, size);
+		return size + delayed_read;
+	}
+
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -201,8 +597,12 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 			break;
 
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
+			/* Read full sectors directly into caller's buffer, as
+			 * many as are wanted in one transfer. */
+			off_t run = (size < inode_left ? size : inode_left)
+				/ DISK_SECTOR_SIZE;
+			journal_read_many (sector_idx, buffer + bytes_read, run);
+			chunk_size = run * DISK_SECTOR_SIZE;
 		} else {
 			/* Read sector into bounce buffer, then partially copy
 			 * into caller's buffer. */
@@ -211,7 +611,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 				if (bounce == NULL)
 					break;
 			}
-			disk_read (filesys_disk, sector_idx, bounce);
+			journal_read (sector_idx, bounce);
 			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
 		}
 
@@ -222,23 +622,37 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	}
 	free (bounce);
 
-	return bytes_read;
+	if (size > 0)
+		return bytes_read;
+	return bytes_read + delayed_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
- * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
-off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+/* Writes SIZE bytes from BUFFER into INODE at OFFSET on disk,
+ * extending the inode if the write ends past end of file.
+ * Returns the number of bytes actually written. */
+static off_t
+write_at (struct inode *inode, const uint8_t *buffer, off_t size,
 		off_t offset) {
-	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
 
-	if (inode->deny_write_cnt)
-		return 0;
+	/* Grow INODE if the write ends past end of file.  If that fails,
+	 * write only what fits. */
+	if (size > 0 && offset + size > inode->length) {
+		journal_begin ();
+		extend (inode, offset, size);
+		journal_end ();
+	}
+
+	if (inode->inline_disk != NULL) {
+		if (offset >= inode->disk_length)
+			return 0;
+		if (size > inode->disk_length - offset)
+			size = inode->disk_length - offset;
+		memcpy (inode->inline_disk->inline_data + offset, buffer, size);
+		write_disk_inode (inode);
+		return size;
+	}
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -256,8 +670,13 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 			break;
 
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
+			/* Write full sectors directly to disk, as many as are
+			 * wanted in one transfer. */
+			off_t run = (size < inode_left ? size : inode_left)
+				/ DISK_SECTOR_SIZE;
+			journal_write_many (sector_idx, buffer + bytes_written, run,
+					inode->metadata);
+			chunk_size = run * DISK_SECTOR_SIZE;
 		} else {
 			/* We need a bounce buffer. */
 			if (bounce == NULL) {
@@ -270,11 +689,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 			   we're writing, then we need to read in the sector
 			   first.  Otherwise we start with a sector of all zeros. */
 			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
+				journal_read (sector_idx, bounce);
 			else
 				memset (bounce, 0, DISK_SECTOR_SIZE);
 			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
+			journal_write (sector_idx, bounce, inode->metadata); 
 		}
 
 		/* Advance. */
@@ -287,6 +706,136 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	return bytes_written;
 }
 
+/* Takes a write of SIZE bytes from BUFFER at OFFSET into INODE's
+ * delayed data, without touching the disk, if it lies wholly past
+ * the data on disk and within DELAY_BYTES of it.  Only regular files
+ * delay writes, and an inline file only once it outgrows its inode.
+ * Sectors for the data are reserved now, so that writing it back
+ * cannot run out of space; if they cannot be, the write is not
+ * taken.  Must be called with INODE's delayed_lock held.
+ * Returns true if the write was taken. */
+static bool
+delay (struct inode *inode, const void *buffer, off_t size, off_t offset) {
+	bool ok;
+
+	if (inode->metadata || size <= 0 || offset < inode->disk_length
+			|| offset + size - inode->disk_length > DELAY_BYTES
+			|| (inode->inline_disk != NULL && offset + size <= (off_t) INLINE_MAX))
+		return false;
+
+	if (bytes_to_sectors (offset + size) > inode->sector_cnt) {
+		journal_begin ();
+		ok = reserve (inode, offset + size);
+		if (ok)
+			write_disk_inode (inode);
+		journal_end ();
+		if (!ok)
+			return false;
+	}
+	if (inode->delayed == NULL) {
+		inode->delayed = calloc (1, DELAY_BYTES);
+		if (inode->delayed == NULL)
+			return false;
+	}
+	memcpy (inode->delayed + (offset - inode->disk_length), buffer, size);
+	if (offset + size > inode->length)
+		inode->length = offset + size;
+	delayed_cnt++;
+	return true;
+}
+
+/* Writes INODE's delayed data to disk.  Its sectors were reserved
+ * when it was delayed, so all of it is written as one run, and each
+ * sector is written once however many writes filled it.
+ * Must be called with INODE's delayed_lock held. */
+static void
+writeback (struct inode *inode) {
+	uint8_t *data = inode->delayed;
+	off_t size = inode->length - inode->disk_length;
+
+	ASSERT (lock_held_by_current_thread (&inode->delayed_lock));
+	if (data == NULL)
+		return;
+	inode->delayed = NULL;
+	inode->length = inode->disk_length;
+	write_at (inode, data, size, inode->disk_length);
+	free (data);
+	writeback_cnt++;
+}
+
+/* Writes the delayed data of every open inode to disk.
+ * Each inode is written back with open_inodes_lock released, under
+ * a reference of our own, so that opening and closing files need
+ * not wait on its disk writes. */
+void
+inode_sync (void) {
+	for (;;) {
+		struct inode *inode = NULL;
+		struct hash_iterator i;
+
+		lock_acquire (&open_inodes_lock);
+		hash_first (&i, &open_inodes);
+		while (hash_next (&i)) {
+			struct inode *cur = hash_entry (hash_cur (&i), struct inode, elem);
+			if (cur->delayed != NULL) {
+				inode = cur;
+				inode->open_cnt++;
+				break;
+			}
+		}
+		lock_release (&open_inodes_lock);
+		if (inode == NULL)
+			break;
+
+		lock_acquire (&inode->delayed_lock);
+		writeback (inode);
+		lock_release (&inode->delayed_lock);
+		inode_close (inode);
+	}
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * Returns the number of bytes actually written, which may be
+ * less than SIZE if the disk fills up or an error occurs.
+ * A write past end of file extends the inode.
+ *
+ * Appends are delayed: their data stays in memory until it fills
+ * DELAY_BYTES, the inode is closed for the last time or the file
+ * system is synced, so that a file written in small appends gets
+ * its sectors in a few large allocations and each sector is
+ * written once. */
+off_t
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	uint8_t *copy = NULL;
+	bool delayed;
+
+	if (inode->deny_write_cnt)
+		return 0;
+
+	/* BUFFER may fault, and the fault may read INODE, so copy a
+	 * write that might be delayed before taking delayed_lock. */
+	if (!inode->metadata && size > 0 && size <= DELAY_BYTES
+			&& offset >= inode->disk_length) {
+		copy = malloc (size);
+		if (copy != NULL)
+			memcpy (copy, buffer, size);
+	}
+
+	lock_acquire (&inode->delayed_lock);
+	delayed = copy != NULL && delay (inode, copy, size, offset);
+	if (!delayed && inode->delayed != NULL
+			&& offset + size > inode->disk_length) {
+		writeback (inode);
+		delayed = copy != NULL && delay (inode, copy, size, offset);
+	}
+	lock_release (&inode->delayed_lock);
+	free (copy);
+	if (delayed)
+		return size;
+	return write_at (inode, buffer, size, offset);
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 	void
@@ -309,5 +858,14 @@ inode_allow_write (struct inode *inode) {
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
-	return inode->data.length;
+	return inode->length;
+}
+
+/* Prints inode statistics. */
+void
+inode_print_stats (void) {
+	printf ("inode: %lld extended in place, %lld relocated, "
+			"%lld moved out of line\n", extend_cnt, relocate_cnt, spill_cnt);
+	printf ("inode: %lld writes delayed, %lld written back\n",
+			delayed_cnt, writeback_cnt);
 }
@@ -0,0 +1,437 @@
+/* journal.c: Write-ahead log for file system metadata.
+ *
+ * Metadata sectors -- inodes, directory contents and the free map --
+ * are not written in place right away.  journal_write() copies them
+ * into the running transaction instead, where a later write to the
+ * same sector simply replaces the earlier copy, and journal_read()
+ * returns the copy as long as it is there.  Other sectors are
+ * written straight to disk, after dropping any copy of the same
+ * sector from the transaction, since that sector has been freed and
+ * reused as file data.
+ *
+ * A commit writes the transaction's sectors one after another into
+ * the log, a fixed run of sectors owned by the journal file at
+ * JOURNAL_SECTOR, and then the log header that lists their homes.
+ * Writing the header is the commit point.  The sectors are then
+ * written to their homes and the header cleared.  If the machine
+ * stops in between, journal_init() finds the header still set and
+ * writes the sectors home again.
+ *
+ * File system operations run between journal_begin() and
+ * journal_end(), and a commit waits until none is running, so that
+ * each one is committed as a whole.  An operation that may write
+ * more sectors than JOURNAL_RESERVE calls journal_split() between
+ * steps that leave the file system consistent, to let a commit
+ * happen there.  Many operations share one commit: it happens only
+ * when the transaction is nearly full, every JOURNAL_INTERVAL ticks,
+ * on journal_sync() and at shutdown, unless journal_commit_each asks
+ * for a commit after every operation.
+ *
+ * Sectors freed by an operation go back to the free map only after
+ * the transaction has committed.  Until then the inodes on disk may
+ * still point at them, so another file must not get them and write
+ * its data over them. */
+
+#include "filesys/journal.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Identifies a log header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Sectors a transaction can hold: as many as the header can list. */
+#define JOURNAL_ENTRIES ((DISK_SECTOR_SIZE - 8) / sizeof (disk_sector_t))
+
+/* Free entries an operation may need.  Checked when it begins. */
+#define JOURNAL_RESERVE 32
+
+/* Ticks between background commits. */
+#define JOURNAL_INTERVAL (5 * TIMER_FREQ)
+
+/* Log header, the first sector of the log. */
+struct journal_header {
+	uint32_t magic;                     /* JOURNAL_MAGIC. */
+	uint32_t cnt;                       /* Committed sectors, 0 if none. */
+	disk_sector_t homes[JOURNAL_ENTRIES];   /* Where each one belongs. */
+};
+
+bool journal_commit_each;
+
+static bool enabled;                    /* Log found and replayed? */
+static disk_sector_t log_start;         /* Header sector of the log. */
+static struct lock journal_lock;        /* Protects everything below. */
+static struct condition idle;           /* Signaled when ACTIVE drops to 0. */
+static int active;                      /* Operations running. */
+
+/* Running transaction. */
+static struct journal_header *header;   /* Homes of the sectors. */
+static uint8_t (*blocks)[DISK_SECTOR_SIZE]; /* Contents of the sectors. */
+static size_t cnt;                      /* Sectors held. */
+
+/* A run of sectors freed by an operation, waiting for its commit. */
+struct release {
+	struct list_elem elem;              /* Element in PENDING or COMMITTED. */
+	disk_sector_t sector;               /* First sector. */
+	size_t sector_cnt;                  /* Number of sectors. */
+};
+
+static struct list pending;             /* Freed in the running transaction. */
+static struct list committed;           /* Freed and committed. */
+static bool releasing;                  /* In release_committed()? */
+
+/* Statistics. */
+static long long commit_cnt, logged_cnt, absorbed_cnt, deferred_cnt;
+
+static void journald (void *aux UNUSED);
+
+/* Creates the journal file while formatting the file system. */
+void
+journal_create (void) {
+	struct journal_header *h;
+	struct inode *inode;
+
+	if (!inode_create (JOURNAL_SECTOR,
+				(JOURNAL_ENTRIES + 1) * DISK_SECTOR_SIZE))
+		PANIC ("journal creation failed");
+	inode = inode_open (JOURNAL_SECTOR);
+	h = calloc (1, sizeof *h);
+	if (inode == NULL || h == NULL)
+		PANIC ("journal creation failed");
+	h->magic = JOURNAL_MAGIC;
+	disk_write (filesys_disk, inode_byte_to_sector (inode, 0), h);
+	free (h);
+	inode_close (inode);
+}
+
+/* Opens the journal and replays any transaction that was committed
+ * but not completely written home.  A disk formatted without a
+ * journal is used as before, with every write going straight to
+ * disk. */
+void
+journal_init (void) {
+	struct inode *inode;
+	size_t i;
+
+	lock_init (&journal_lock);
+	cond_init (&idle);
+	list_init (&pending);
+	list_init (&committed);
+	header = calloc (1, sizeof *header);
+	blocks = malloc (JOURNAL_ENTRIES * sizeof *blocks);
+	if (header == NULL || blocks == NULL)
+		PANIC ("journal allocation failed");
+
+	inode = inode_open (JOURNAL_SECTOR);
+	if (inode == NULL)
+		return;
+	if (inode_length (inode) == (JOURNAL_ENTRIES + 1) * DISK_SECTOR_SIZE) {
+		log_start = inode_byte_to_sector (inode, 0);
+		disk_read (filesys_disk, log_start, header);
+		enabled = header->magic == JOURNAL_MAGIC;
+	}
+	inode_close (inode);
+	if (!enabled)
+		return;
+
+	if (header->cnt > 0) {
+		for (i = 0; i < header->cnt; i++) {
+			disk_read (filesys_disk, log_start + 1 + i, blocks[0]);
+			disk_write (filesys_disk, header->homes[i], blocks[0]);
+		}
+		printf ("journal: replayed %u sectors\n", header->cnt);
+		header->cnt = 0;
+		disk_write (filesys_disk, log_start, header);
+	}
+
+	thread_create ("journald", PRI_MIN, journald, NULL);
+}
+
+/* Commits the running transaction.
+ * Must be called with journal_lock held and no operation running,
+ * except when an operation has overflowed the transaction. */
+static void
+commit (void) {
+	size_t i;
+
+	if (cnt == 0)
+		return;
+
+	for (i = 0; i < cnt; i++)
+		disk_write (filesys_disk, log_start + 1 + i, blocks[i]);
+	header->magic = JOURNAL_MAGIC;
+	header->cnt = cnt;
+	disk_write (filesys_disk, log_start, header);
+
+	for (i = 0; i < cnt; i++)
+		disk_write (filesys_disk, header->homes[i], blocks[i]);
+	header->cnt = 0;
+	disk_write (filesys_disk, log_start, header);
+
+	commit_cnt++;
+	logged_cnt += cnt;
+	cnt = 0;
+
+	while (!list_empty (&pending))
+		list_push_back (&committed, list_pop_front (&pending));
+}
+
+/* Returns the sectors freed by committed transactions to the free
+ * map.  Must be called without journal_lock held. */
+static void
+release_committed (void) {
+	lock_acquire (&journal_lock);
+	if (releasing) {
+		lock_release (&journal_lock);
+		return;
+	}
+	releasing = true;
+	while (!list_empty (&committed)) {
+		struct release *r = list_entry (list_pop_front (&committed),
+				struct release, elem);
+
+		lock_release (&journal_lock);
+		journal_begin ();
+		free_map_release_now (r->sector, r->sector_cnt);
+		journal_end ();
+		free (r);
+		lock_acquire (&journal_lock);
+	}
+	releasing = false;
+	lock_release (&journal_lock);
+}
+
+/* Commits everything written so far, at shutdown. */
+void
+journal_done (void) {
+	journal_sync ();
+}
+
+/* Starts a file system operation.  Commits first if the transaction
+ * may not have room for it. */
+void
+journal_begin (void) {
+	if (!enabled)
+		return;
+	lock_acquire (&journal_lock);
+	if (active == 0 && cnt + JOURNAL_RESERVE > JOURNAL_ENTRIES)
+		commit ();
+	active++;
+	lock_release (&journal_lock);
+}
+
+/* Ends a file system operation. */
+void
+journal_end (void) {
+	if (!enabled)
+		return;
+	lock_acquire (&journal_lock);
+	ASSERT (active > 0);
+	if (--active == 0) {
+		if (journal_commit_each || cnt + JOURNAL_RESERVE > JOURNAL_ENTRIES)
+			commit ();
+		cond_broadcast (&idle, &journal_lock);
+	}
+	lock_release (&journal_lock);
+	release_committed ();
+}
+
+/* Marks a point within the running operation at which the file
+ * system is consistent, letting the transaction commit there if it
+ * is nearly full.  Must be called between journal_begin() and
+ * journal_end(). */
+void
+journal_split (void) {
+	if (!enabled)
+		return;
+	journal_end ();
+	journal_begin ();
+}
+
+/* Frees SECTOR_CNT sectors starting at SECTOR once the running
+ * transaction has committed.  Returns false if the journal is not in
+ * use or memory is short, in which case the caller frees them at
+ * once. */
+bool
+journal_release (disk_sector_t sector, size_t sector_cnt) {
+	struct release *r;
+
+	if (!enabled)
+		return false;
+	r = malloc (sizeof *r);
+	if (r == NULL)
+		return false;
+	r->sector = sector;
+	r->sector_cnt = sector_cnt;
+	lock_acquire (&journal_lock);
+	list_push_back (&pending, &r->elem);
+	deferred_cnt++;
+	lock_release (&journal_lock);
+	return true;
+}
+
+/* Waits for running operations to end, then commits. */
+void
+journal_sync (void) {
+	if (!enabled)
+		return;
+	lock_acquire (&journal_lock);
+	while (active > 0)
+		cond_wait (&idle, &journal_lock);
+	commit ();
+	lock_release (&journal_lock);
+	release_committed ();
+}
+
+/* Returns the index of SECTOR in the running transaction, or -1.
+ * Must be called with journal_lock held. */
+static int
+find (disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < cnt; i++)
+		if (header->homes[i] == sector)
+			return i;
+	return -1;
+}
+
+/* Drops entry I from the running transaction.
+ * Must be called with journal_lock held. */
+static void
+revoke (int i) {
+	cnt--;
+	header->homes[i] = header->homes[cnt];
+	memcpy (blocks[i], blocks[cnt], DISK_SECTOR_SIZE);
+}
+
+/* Reads SECTOR into BUFFER, from the running transaction if it
+ * holds a copy. */
+void
+journal_read (disk_sector_t sector, void *buffer) {
+	int i;
+
+	if (enabled) {
+		lock_acquire (&journal_lock);
+		i = find (sector);
+		if (i >= 0) {
+			memcpy (buffer, blocks[i], DISK_SECTOR_SIZE);
+			lock_release (&journal_lock);
+			return;
+		}
+		lock_release (&journal_lock);
+	}
+	disk_read (filesys_disk, sector, buffer);
+}
+
+/* Writes BUFFER to SECTOR.  A METADATA sector goes into the running
+ * transaction; any other sector goes to disk. */
+void
+journal_write (disk_sector_t sector, const void *buffer, bool metadata) {
+	int i;
+
+	if (!enabled) {
+		disk_write (filesys_disk, sector, buffer);
+		return;
+	}
+
+	lock_acquire (&journal_lock);
+	i = find (sector);
+	if (metadata) {
+		if (i >= 0)
+			absorbed_cnt++;
+		else {
+			/* An operation larger than JOURNAL_RESERVE overflowed the
+			 * transaction.  Commit it unfinished rather than fail. */
+			if (cnt == JOURNAL_ENTRIES)
+				commit ();
+			i = cnt++;
+			header->homes[i] = sector;
+		}
+		memcpy (blocks[i], buffer, DISK_SECTOR_SIZE);
+		lock_release (&journal_lock);
+		return;
+	}
+
+	if (i >= 0)
+		revoke (i);
+	lock_release (&journal_lock);
+	disk_write (filesys_disk, sector, buffer);
+}
+
+/* Reads SECTOR_CNT sectors starting at SECTOR into BUFFER, in one
+ * transfer unless the running transaction holds one of them. */
+void
+journal_read_many (disk_sector_t sector, void *buffer, size_t sector_cnt) {
+	size_t k;
+
+	if (enabled) {
+		lock_acquire (&journal_lock);
+		for (k = 0; k < sector_cnt; k++)
+			if (find (sector + k) >= 0)
+				break;
+		lock_release (&journal_lock);
+		if (k < sector_cnt) {
+			for (k = 0; k < sector_cnt; k++)
+				journal_read (sector + k,
+						(uint8_t *) buffer + k * DISK_SECTOR_SIZE);
+			return;
+		}
+	}
+	disk_read_many (filesys_disk, sector, buffer, sector_cnt);
+}
+
+/* Writes SECTOR_CNT sectors starting at SECTOR from BUFFER, like
+ * journal_write().  Sectors that are not METADATA go to disk in one
+ * transfer. */
+void
+journal_write_many (disk_sector_t sector, const void *buffer,
+		size_t sector_cnt, bool metadata) {
+	size_t k;
+
+	if (metadata) {
+		for (k = 0; k < sector_cnt; k++)
+			journal_write (sector + k,
+					(const uint8_t *) buffer + k * DISK_SECTOR_SIZE, true);
+		return;
+	}
+
+	if (enabled) {
+		lock_acquire (&journal_lock);
+		for (k = 0; k < sector_cnt; k++) {
+			int i = find (sector + k);
+			if (i >= 0)
+				revoke (i);
+		}
+		lock_release (&journal_lock);
+	}
+	disk_write_many (filesys_disk, sector, buffer, sector_cnt);
+}
+
+/* Commits in the background every JOURNAL_INTERVAL ticks, when no
+ * operation is running. */
+static void
+journald (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (JOURNAL_INTERVAL);
+		lock_acquire (&journal_lock);
+		if (active == 0)
+			commit ();
+		lock_release (&journal_lock);
+	}
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void) {
+	printf ("journal: %lld commits, %lld sectors logged, "
+			"%lld writes absorbed, %lld frees deferred\n",
+			commit_cnt, logged_cnt, absorbed_cnt, deferred_cnt);
+}
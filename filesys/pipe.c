@@ -0,0 +1,185 @@
+/* pipe.c: Pipes between processes.
+ *
+ * A pipe is a one-page ring with two free-running byte counters: HEAD,
+ * advanced only by the reader, and TAIL, advanced only by the writer.
+ * Each side is serialized among its own holders by READ_LOCK or
+ * WRITE_LOCK, since an end may be shared by several processes after
+ * fork(), but the reader and the writer never take a common lock.
+ *
+ * A side that finds the ring empty (or full) raises its WAITING flag,
+ * checks again and sleeps on its semaphore.  Its peer looks at the
+ * flag after moving its counter and raises the semaphore only when it
+ * is set, which happens only when the ring has just gone from empty to
+ * non-empty (or from full to non-full), so a steady stream of data
+ * costs no semaphore operations at all. */
+
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+struct pipe {
+	uint8_t *buf;                   /* PIPE_SIZE bytes of data. */
+	volatile size_t head;           /* Bytes read so far. */
+	volatile size_t tail;           /* Bytes written so far. */
+	struct lock read_lock;          /* Serializes readers. */
+	struct lock write_lock;         /* Serializes writers. */
+	struct semaphore readable;      /* Raised for a waiting reader. */
+	struct semaphore writable;      /* Raised for a waiting writer. */
+	volatile bool reader_waiting;   /* Reader found the ring empty. */
+	volatile bool writer_waiting;   /* Writer found the ring full. */
+	int readers;                    /* Open read ends. */
+	int writers;                    /* Open write ends. */
+};
+
+/* Raises SEMA if *WAITING says a peer sleeps on it. */
+static void
+pipe_wake (volatile bool *waiting, struct semaphore *sema) {
+	barrier ();
+	if (*waiting) {
+		*waiting = false;
+		sema_up (sema);
+	}
+}
+
+/* Creates a pipe with no ends open.  Returns a null pointer if
+ * memory is short. */
+struct pipe *
+pipe_create (void) {
+	ASSERT (PIPE_SIZE == PGSIZE);
+
+	struct pipe *p = calloc (1, sizeof *p);
+	if (p == NULL)
+		return NULL;
+	p->buf = palloc_get_page (0);
+	if (p->buf == NULL) {
+		free (p);
+		return NULL;
+	}
+	lock_init (&p->read_lock);
+	lock_init (&p->write_lock);
+	sema_init (&p->readable, 0);
+	sema_init (&p->writable, 0);
+	return p;
+}
+
+/* Counts a new read end, or write end if WRITER, of P. */
+void
+pipe_open_end (struct pipe *p, bool writer) {
+	enum intr_level old_level = intr_disable ();
+	if (writer)
+		p->writers++;
+	else
+		p->readers++;
+	intr_set_level (old_level);
+}
+
+/* Closes a read end, or write end if WRITER, of P.  Closing the last
+ * write end wakes a waiting reader to see end of file, closing the
+ * last read end wakes a waiting writer to fail, and closing the very
+ * last end frees P. */
+void
+pipe_close_end (struct pipe *p, bool writer) {
+	enum intr_level old_level = intr_disable ();
+	bool last;
+
+	if (writer) {
+		if (--p->writers == 0)
+			pipe_wake (&p->reader_waiting, &p->readable);
+	} else {
+		if (--p->readers == 0)
+			pipe_wake (&p->writer_waiting, &p->writable);
+	}
+	last = p->readers == 0 && p->writers == 0;
+	intr_set_level (old_level);
+
+	if (last) {
+		palloc_free_page (p->buf);
+		free (p);
+	}
+}
+
+/* Reads up to SIZE bytes from P into BUFFER.  Waits for data unless
+ * NONBLOCK, then returns what is there without waiting for more.
+ * Returns 0 at end of file, when the ring is empty and every write
+ * end is closed, or -1 if the ring is empty and NONBLOCK. */
+off_t
+pipe_read (struct pipe *p, void *buffer, off_t size, bool nonblock) {
+	uint8_t *dst = buffer;
+	size_t head, avail, ofs, n, first;
+
+	if (size <= 0)
+		return 0;
+
+	lock_acquire (&p->read_lock);
+	while (p->head == p->tail) {
+		if (p->writers == 0 || nonblock) {
+			lock_release (&p->read_lock);
+			return p->writers == 0 ? 0 : -1;
+		}
+		p->reader_waiting = true;
+		barrier ();
+		if (p->head == p->tail && p->writers > 0)
+			sema_down (&p->readable);
+		p->reader_waiting = false;
+	}
+
+	head = p->head;
+	avail = p->tail - head;
+	n = avail < (size_t) size ? avail : (size_t) size;
+	ofs = head % PIPE_SIZE;
+	first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+	memcpy (dst, p->buf + ofs, first);
+	memcpy (dst + first, p->buf, n - first);
+	barrier ();
+	p->head = head + n;
+	pipe_wake (&p->writer_waiting, &p->writable);
+	lock_release (&p->read_lock);
+	return n;
+}
+
+/* Writes SIZE bytes from BUFFER into P, waiting for room as needed.
+ * If NONBLOCK, writes only what fits right away.  Returns the bytes
+ * written, or -1 if no read end is open or nothing fit. */
+off_t
+pipe_write (struct pipe *p, const void *buffer, off_t size, bool nonblock) {
+	const uint8_t *src = buffer;
+	off_t done = 0;
+
+	lock_acquire (&p->write_lock);
+	while (done < size) {
+		size_t tail = p->tail;
+		size_t room = PIPE_SIZE - (tail - p->head);
+		size_t ofs, n, first;
+
+		if (p->readers == 0)
+			break;
+		if (room == 0) {
+			if (nonblock)
+				break;
+			p->writer_waiting = true;
+			barrier ();
+			if (p->tail - p->head == PIPE_SIZE && p->readers > 0)
+				sema_down (&p->writable);
+			p->writer_waiting = false;
+			continue;
+		}
+
+		n = room < (size_t) (size - done) ? room : (size_t) (size - done);
+		ofs = tail % PIPE_SIZE;
+		first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+		memcpy (p->buf + ofs, src + done, first);
+		memcpy (p->buf, src + done + first, n - first);
+		barrier ();
+		p->tail = tail + n;
+		pipe_wake (&p->reader_waiting, &p->readable);
+		done += n;
+	}
+	lock_release (&p->write_lock);
+	return done > 0 || size == 0 ? done : -1;
+}
@@ -0,0 +1,18 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Sector recorded for a name known not to exist. */
+#define DCACHE_NEGATIVE ((disk_sector_t) -1)
+
+struct inode;
+
+void dcache_init (void);
+bool dcache_lookup (struct inode *dir, const char *name, disk_sector_t *);
+void dcache_insert (struct inode *dir, const char *name, disk_sector_t);
+void dcache_forget (disk_sector_t dir);
+void dcache_print_stats (void);
+
+#endif /* filesys/dcache.h */
@@ -0,0 +1,12 @@
+#ifndef FILESYS_DEFRAG_H
+#define FILESYS_DEFRAG_H
+
+#include <stdbool.h>
+
+/* Run the defragmenter thread? */
+extern bool defrag_enabled;
+
+void defrag_init (void);
+void defrag_print_stats (void);
+
+#endif /* filesys/defrag.h */
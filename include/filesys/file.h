@@ -1,17 +1,34 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
+struct dir;
+struct shm_segment;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
 struct file *file_duplicate (struct file *file);
+struct file *file_ref (struct file *);
+int file_ref_cnt (struct file *);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
 
+/* Pipes. */
+bool file_open_pipe (struct file *ends[2], bool nonblock);
+bool file_is_pipe (struct file *);
+
+/* Directories. */
+struct file *file_open_dir (struct dir *);
+struct dir *file_get_dir (struct file *);
+
+/* Shared memory. */
+struct file *file_open_shm (struct shm_segment *);
+struct shm_segment *file_get_shm (struct file *);
+
 /* Reading and writing. */
 off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
@@ -3,16 +3,27 @@
 
 #include <stdbool.h>
 #include "filesys/off_t.h"
+#include "devices/disk.h"
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#define JOURNAL_SECTOR 2        /* Journal file inode sector. */
 
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
 
+/* Sectors per chunk of a striped file system, or 0 if not striped. */
+extern unsigned filesys_stripe_chunk;
+
+/* Sectors at the start of hd1:1 taken by a striped file system, or 0
+ * if not striped.  Swap uses the rest of hd1:1. */
+extern disk_sector_t filesys_swap_start;
+
 void filesys_init (bool format);
 void filesys_done (void);
+void filesys_print_stats (void);
+void filesys_sync (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
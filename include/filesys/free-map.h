@@ -12,6 +12,11 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, disk_sector_t *);
+bool free_map_allocate_near (size_t, disk_sector_t goal, disk_sector_t *);
+bool free_map_allocate_at (disk_sector_t, size_t);
+disk_sector_t free_map_inode_goal (disk_sector_t dir_sector);
 void free_map_release (disk_sector_t, size_t);
+void free_map_release_now (disk_sector_t, size_t);
+size_t free_map_free_runs (size_t *run_cnt);
 
 #endif /* filesys/free-map.h */
@@ -0,0 +1,29 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+
+/* Commit after every operation instead of in batches? */
+extern bool journal_commit_each;
+
+void journal_create (void);
+void journal_init (void);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_sync (void);
+void journal_split (void);
+bool journal_release (disk_sector_t, size_t sector_cnt);
+
+void journal_read (disk_sector_t, void *);
+void journal_write (disk_sector_t, const void *, bool metadata);
+void journal_read_many (disk_sector_t, void *, size_t sector_cnt);
+void journal_write_many (disk_sector_t, const void *, size_t sector_cnt,
+		bool metadata);
+
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
@@ -0,0 +1,18 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+/* Capacity of a pipe's ring, in bytes. */
+#define PIPE_SIZE 4096
+
+struct pipe;
+
+struct pipe *pipe_create (void);
+void pipe_open_end (struct pipe *, bool writer);
+void pipe_close_end (struct pipe *, bool writer);
+off_t pipe_read (struct pipe *, void *, off_t size, bool nonblock);
+off_t pipe_write (struct pipe *, const void *, off_t size, bool nonblock);
+
+#endif /* filesys/pipe.h */
@@ -0,0 +1,31 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* LZ77 compressor with an LZ4-style block format.
+
+   A block is a series of sequences.  Each sequence is a token byte,
+   whose high nibble is the literal count and low nibble the match
+   length minus LZ_MIN_MATCH, followed by the literals, a 16-bit
+   little-endian match offset and, where a nibble is 15, extra length
+   bytes that are summed until one is below 255.  The last sequence has
+   literals only.
+
+   Speed matters more than ratio here: matches are found through a
+   single-entry hash table and never searched further. */
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 10
+
+/* Bytes of scratch memory lz_compress() needs. */
+#define LZ_WORK_SIZE ((1 << LZ_HASH_BITS) * sizeof (uint16_t))
+
+size_t lz_compress (const void *src, size_t src_len,
+                    void *dst, size_t dst_cap, void *work);
+bool lz_decompress (const void *src, size_t src_len,
+                    void *dst, size_t dst_len);
+
+#endif /* lib/kernel/lz.h */
@@ -36,6 +36,25 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_SPAWN,                  /* Start a process from an executable. */
+	SYS_READV,                  /* Read into several buffers. */
+	SYS_WRITEV,                 /* Write from several buffers. */
+	SYS_PREAD,                  /* Read at an offset. */
+	SYS_PWRITE,                 /* Write at an offset. */
+	SYS_URING_SETUP,            /* Map asynchronous I/O rings. */
+	SYS_URING_ENTER,            /* Submit to and wait on the rings. */
+	SYS_SENDFILE,               /* Copy between descriptors in the kernel. */
+	SYS_PIPE,                   /* Create a pipe. */
+	SYS_SHM_OPEN,               /* Open a shared memory segment. */
+	SYS_SHM_UNLINK,             /* Remove a shared memory segment's name. */
+	SYS_FUTEX_WAIT,             /* Sleep on a futex. */
+	SYS_FUTEX_WAKE,             /* Wake up futex sleepers. */
+	SYS_FSYNC,                  /* Make a file's updates durable. */
+	SYS_SYNC,                   /* Make all file system updates durable. */
+	SYS_GETDENTS,               /* Read many directory entries. */
+	SYS_TICKS,                  /* Timer ticks since boot. */
 };
 
 #endif /* lib/syscall-nr.h */
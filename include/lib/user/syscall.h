@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,9 +14,85 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* One entry of the fd remapping list passed to spawn(): the child
+   receives a duplicate of the parent's PARENT_FD as CHILD_FD. */
+struct spawn_fd {
+	int child_fd;
+	int parent_fd;
+};
+
+/* One buffer of a readv() or writev() call. */
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+
+/* Most buffers one readv() or writev() call accepts. */
+#define IOV_MAX 64
+
+/* pipe2() flag: neither end waits.  Reading an empty pipe or writing
+   a full one returns -1 at once. */
+#define PIPE_NONBLOCK 0x1
+
+/* Asynchronous I/O rings, shared between a process and the kernel.
+   uring_setup() maps a struct uring at a page-aligned address, followed
+   by a buffer area that all URING_READ and URING_WRITE buffers and
+   URING_OPEN paths must lie in.  The process fills SQ entries and
+   advances sq_tail; uring_enter() hands them to kernel workers, which
+   post results to the CQ by advancing cq_tail.  The process consumes
+   CQ entries by advancing cq_head, without a system call. */
+#define URING_MAX_ENTRIES 32
+
+enum uring_op {
+	URING_NOP,                  /* Completes with 0. */
+	URING_READ,                 /* pread() LEN bytes at OFF into ADDR. */
+	URING_WRITE,                /* pwrite() LEN bytes at OFF from ADDR. */
+	URING_FSYNC,                /* Completes once earlier writes are done. */
+	URING_OPEN,                 /* open() the path at ADDR. */
+};
+
+/* Submission queue entry. */
+struct uring_sqe {
+	int opcode;                 /* One of enum uring_op. */
+	int fd;
+	void *addr;
+	unsigned len;
+	off_t off;
+	uint64_t user_data;         /* Copied to the completion. */
+};
+
+/* Completion queue entry. */
+struct uring_cqe {
+	uint64_t user_data;
+	int res;                    /* What the synchronous call returns. */
+};
+
+struct uring {
+	volatile unsigned sq_head;  /* Advanced by the kernel. */
+	volatile unsigned sq_tail;  /* Advanced by the process. */
+	volatile unsigned cq_head;  /* Advanced by the process. */
+	volatile unsigned cq_tail;  /* Advanced by the kernel. */
+	unsigned sq_entries;        /* Power of two, URING_MAX_ENTRIES at most. */
+	unsigned cq_entries;        /* Twice SQ_ENTRIES. */
+	struct uring_sqe sq[URING_MAX_ENTRIES];
+	struct uring_cqe cq[2 * URING_MAX_ENTRIES];
+};
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* Directory entry written by getdents(). */
+struct dirent {
+	unsigned d_ino;             /* Inode number. */
+	unsigned d_off;             /* seek() here to resume after this entry. */
+	unsigned char d_type;       /* DT_REG or DT_DIR. */
+	char d_name[READDIR_MAX_LEN + 1];
+};
+
+/* Values of d_type. */
+#define DT_REG 1                /* Regular file. */
+#define DT_DIR 2                /* Directory. */
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -25,6 +102,7 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t fork(const char *thread_name);
 int exec (const char *file);
+pid_t spawn (const char *cmd_line, const struct spawn_fd *fds, size_t fd_cnt);
 int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
@@ -35,6 +113,23 @@ int write (int fd, const void *buffer, unsigned length);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int uring_setup (void *addr, unsigned entries, size_t buf_size);
+int uring_enter (unsigned to_submit, unsigned min_complete);
+int sendfile (int out_fd, int in_fd, unsigned count);
+int pipe (int fds[2]);
+int pipe2 (int fds[2], int flags);
+int shm_open (const char *name, size_t size);
+bool shm_unlink (const char *name);
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int cnt);
+int fsync (int fd);
+void sync (void);
+int getdents (int fd, struct dirent *ents, unsigned cnt);
+int64_t ticks (void);
 
 int dup2(int oldfd, int newfd);
 
@@ -9,6 +9,9 @@
 #ifdef VM
 #include "vm/vm.h"
 #endif
+#ifdef USERPROG
+#include "userprog/fdtable.h"
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -30,8 +33,8 @@ typedef int tid_t;
 #define PRI_MAX 63     /* Highest priority. */
 
 /* File descriptor*/
-#define FD_MIN 2   /* Lowest File descriptor */
-#define FD_MAX 127 /* Highest File descriptor */
+#define FD_MIN 2    /* Lowest File descriptor */
+#define FD_MAX 4096 /* File descriptors are below this */
 
 #define STDIN_FILENO 0
 #define STDOUT_FILENO 1
@@ -106,8 +109,10 @@ struct thread
    struct lock *wait_on_lock;   // 해당 쓰레드가 대기하고 있는 lock자료구조의 주소를 저장할 필드
    struct list list_donation;   // multiple donation을 고려하기 위한 리스트
    struct list_elem d_elem;     // 해당 리스트를 위한 elem도 추가
-   struct file **fdt;           // 파일 디스크립터 테이블
-   int next_fd;                 // 테이블 중 비어있는 곳
+#ifdef USERPROG
+   struct fd_table fdt;         // 파일 디스크립터 테이블
+   struct uring_ctx *uring;     // 비동기 I/O 링 (userprog/uring.c)
+#endif
    struct list child_list;      // 자식 스레드 리스트
    struct list_elem child_elem; // 자식 스레드 리스트를 위한 elem
 
@@ -133,6 +138,9 @@ struct thread
    struct supplemental_page_table spt;
    void *stack_bottom;
    void *rsp_stack;
+   struct file *ra_file;        /* mmap'd file of the last readahead. */
+   void *ra_next;               /* Fault address that continues the stream. */
+   size_t ra_pages;             /* Current readahead window, in pages. */
 #endif
 
    /* Owned by thread.c. */
@@ -0,0 +1,46 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+
+/* Slot values standing for the console.  They are not files and
+ * are never closed; anything above FDT_STDOUT is a struct file. */
+#define FDT_STDIN ((struct file *) 1)
+#define FDT_STDOUT ((struct file *) 2)
+
+/* Slots kept inside struct thread before the table moves to the
+ * heap.  Must not exceed 64, the bits of one bitmap word. */
+#define FDT_INLINE 16
+
+/* A process's file descriptor table.
+ *
+ * Starts out as FDT_INLINE slots inside the owning thread, so a
+ * thread that never opens a file allocates nothing.  Installing a
+ * descriptor past the end grows SLOTS and USED on the heap, doubling
+ * up to FD_MAX.  Bit i of USED is set while slot i is taken, and bit
+ * w of FULL while every slot of USED[w] is, so the lowest free
+ * descriptor is two count-trailing-zeros away. */
+struct fd_table {
+	struct file **slots;                 /* CAP slots. */
+	uint64_t *used;                      /* CAP / 64 bitmap words. */
+	uint64_t full;                       /* Full USED words. */
+	int cap;                             /* Number of slots. */
+	struct file *inline_slots[FDT_INLINE];
+	uint64_t inline_used;
+};
+
+void fdt_init (struct fd_table *);
+bool fdt_copy (struct fd_table *dst, const struct fd_table *src);
+void fdt_destroy (struct fd_table *);
+
+struct file *fdt_get (const struct fd_table *, int fd);
+int fdt_install (struct fd_table *, struct file *);
+bool fdt_install_at (struct fd_table *, int fd, struct file *);
+struct file *fdt_remove (struct fd_table *, int fd);
+struct file *fdt_share (struct file *);
+void fdt_release (struct file *);
+
+#endif /* userprog/fdtable.h */
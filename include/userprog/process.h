@@ -6,13 +6,20 @@
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
+struct spawn_fd;
+/* Longest fd remapping list spawn() accepts. */
+#define SPAWN_FD_MAX 256
+tid_t process_spawn (const char *cmd_line, const struct spawn_fd *fds,
+		size_t fd_cnt);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
 int process_add_file (struct file *f);
 struct file *process_get_file(int fd);
+struct file *process_get_file_of(struct thread *t, int fd);
 void process_close_file(int fd);
 void remove_child_process(struct thread *cp);
+struct thread *get_child_process(int pid);
 bool lazy_load_segment (struct page *page, void *aux);
 
 struct segment {
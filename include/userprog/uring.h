@@ -0,0 +1,12 @@
+#ifndef USERPROG_URING_H
+#define USERPROG_URING_H
+
+#include <stddef.h>
+
+void uring_init (void);
+int uring_setup (void *addr, unsigned entries, size_t buf_size);
+int uring_enter (unsigned to_submit, unsigned min_complete);
+void uring_destroy (void);
+void uring_print_stats (void);
+
+#endif /* userprog/uring.h */
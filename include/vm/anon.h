@@ -2,14 +2,22 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct zswap_entry;
 enum vm_type;
 
 struct anon_page {
     struct thread *thread;
     int idx;
+    struct zswap_entry *zswap;  /* Compressed copy, if in zswap. */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+size_t anon_write_slot (const void *kva);
+void anon_read_slot (size_t index, void *kva);
+void anon_free_slot (size_t index);
+void anon_share_slot (struct page *page, size_t index);
+void anon_release_all (struct hash *spt_hash);
+void anon_print_stats (void);
 
 #endif
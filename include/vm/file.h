@@ -10,6 +10,7 @@ struct file_page {
 	off_t offset;
 	struct file *file;
 	size_t read_bytes;
+	struct thread *thread;   /* Owner, whose pml4 maps the page. */
 };
 
 void vm_file_init (void);
@@ -17,4 +18,6 @@ bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *addr);
+void file_backed_writeback (struct page **pages, size_t cnt, uint64_t *pml4);
+void file_backed_print_stats (void);
 #endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include "vm/vm.h"
+
+struct frame;
+
+/* A physical page whose contents ksm found in several anonymous pages.
+ * Every frame mapping it points here; the pages are write-protected and
+ * get a private copy on their first write. */
+struct ksm_page {
+	struct hash_elem elem;   /* Element in the stable table. */
+	void *kva;               /* Shared physical page. */
+	uint64_t checksum;       /* Hash of the contents. */
+	int share_cnt;           /* # of frames mapping KVA. */
+	bool stable;             /* In the stable table? */
+};
+
+void ksm_init (void);
+void ksm_share (struct frame *dst, struct frame *src);
+void ksm_unshare (struct frame *frame);
+void *ksm_release (struct frame *frame);
+void ksm_print_stats (void);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+#include <list.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct hash;
+struct page;
+struct shm_segment;
+struct thread;
+
+/* Longest segment name, not counting the null terminator. */
+#define SHM_NAME_MAX 14
+
+/* Largest segment, in pages. */
+#define SHM_MAX_PAGES 4096
+
+/* A page of a process that maps one page of a shared segment.  It never
+ * owns a frame: the segment keeps the page's frame, which all mappings
+ * share. */
+struct shm_page {
+	struct shm_segment *seg;     /* Segment mapped. */
+	size_t idx;                  /* Page index within SEG. */
+	struct thread *thread;       /* Owner, whose pml4 maps the page. */
+	struct list_elem elem;       /* In the segment page's mapping list. */
+};
+
+void shm_init (void);
+struct shm_segment *shm_segment_open (const char *name, size_t size);
+void shm_segment_reopen (struct shm_segment *);
+void shm_segment_close (struct shm_segment *);
+bool shm_segment_unlink (const char *name);
+size_t shm_segment_size (struct shm_segment *);
+void *shm_map (void *addr, size_t length, bool writable,
+		struct shm_segment *, off_t offset);
+void shm_unmap (void *addr);
+bool shm_claim (struct page *page);
+bool shm_copy_page (struct page *parent);
+void shm_release_all (struct hash *spt_hash);
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int cnt);
+void shm_print_stats (void);
+
+#endif
@@ -13,6 +13,8 @@ enum vm_type {
 	VM_FILE = 2,
 	/* page that hold the page cache, for project 4 */
 	VM_PAGE_CACHE = 3,
+	/* page that maps a shared memory segment, see vm/shm.c */
+	VM_SHM = 4,
 
 	/* Bit flags to store state */
 
@@ -28,12 +30,14 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/shm.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
 
 struct page_operations;
 struct thread;
+struct ksm_page;
 
 #define VM_TYPE(type) ((type) & 7)
 
@@ -63,6 +67,7 @@ struct page {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct shm_page shm;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
@@ -78,6 +83,9 @@ struct frame {
 	void *kva;
 	struct page *page;
 	struct list_elem frame_elem;
+	struct ksm_page *ksm;   /* Merged page this frame maps, if any. */
+	int *share_cnt;         /* Frames mapping KVA since fork(), or NULL. */
+	bool pinned;            /* Used by the kernel; see vm_pin_page(). */
 };
 
 /* The function table for page operations.
@@ -103,6 +111,12 @@ struct supplemental_page_table {
 	struct hash spt_hash;
 };
 
+/* -fa: Map neighbouring pages on file-backed faults? */
+extern bool vm_fault_around_enabled;
+
+/* -reap: Free exited address spaces in the reaperd thread? */
+extern bool vm_reaper_enabled;
+
 #include "threads/thread.h"
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED);
 bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, struct supplemental_page_table *src UNUSED);
@@ -120,4 +134,9 @@ void vm_dealloc_page (struct page *page);
 bool vm_claim_page(void *va UNUSED);
 enum vm_type page_get_type (struct page *page);
 void remove_spt(struct hash_elem *elem, void* aux);
+struct frame *vm_get_frame (bool zero);
+bool vm_frame_is_shared (const struct frame *frame);
+void vm_free_frame (struct frame *frame);
+void *vm_pin_page (void *va);
+void vm_print_stats (void);
 #endif  /* VM_VM_H */
@@ -0,0 +1,164 @@
+#include "lz.h"
+#include <debug.h>
+#include <string.h>
+
+/* Matches farther back than this cannot be encoded. */
+#define LZ_MAX_OFFSET 65535
+
+static uint32_t
+read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+/* Multiplicative hash of the 4 bytes in V. */
+static unsigned
+lz_hash (uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends the extra length bytes for LEN, a length that did not fit in
+   its nibble, at OP.  Returns the new end of output, or a null pointer
+   if it would pass OEND. */
+static uint8_t *
+put_length (uint8_t *op, uint8_t *oend, size_t len) {
+	for (; len >= 255; len -= 255) {
+		if (op >= oend)
+			return NULL;
+		*op++ = 255;
+	}
+	if (op >= oend)
+		return NULL;
+	*op++ = len;
+	return op;
+}
+
+/* Appends a sequence of LIT_LEN literals from LIT followed, unless
+   MATCH_LEN is 0, by a match of MATCH_LEN bytes at OFFSET.  Returns the
+   new end of output, or a null pointer if it would pass OEND. */
+static uint8_t *
+put_sequence (uint8_t *op, uint8_t *oend, const uint8_t *lit,
+		size_t lit_len, size_t offset, size_t match_len) {
+	size_t ml = match_len != 0 ? match_len - LZ_MIN_MATCH : 0;
+	uint8_t *token;
+
+	if (op >= oend)
+		return NULL;
+	token = op++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4 | (ml < 15 ? ml : 15);
+	if (lit_len >= 15 && (op = put_length (op, oend, lit_len - 15)) == NULL)
+		return NULL;
+	if ((size_t) (oend - op) < lit_len)
+		return NULL;
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+
+	if (match_len == 0)
+		return op;
+	if (oend - op < 2)
+		return NULL;
+	*op++ = offset & 0xff;
+	*op++ = offset >> 8;
+	if (ml >= 15)
+		op = put_length (op, oend, ml - 15);
+	return op;
+}
+
+/* Compresses the SRC_LEN bytes at SRC into DST, which has room for
+   DST_CAP bytes, using the LZ_WORK_SIZE bytes at WORK as scratch.
+   Returns the compressed size, or 0 if the output would not fit in
+   DST_CAP bytes. */
+size_t
+lz_compress (const void *src_, size_t src_len,
+		void *dst_, size_t dst_cap, void *work) {
+	const uint8_t *src = src_;
+	const uint8_t *end = src + src_len;
+	const uint8_t *ip = src, *anchor = src;
+	uint8_t *op = dst_, *oend = op + dst_cap;
+	uint16_t *table = work;
+
+	ASSERT (src_len <= LZ_MAX_OFFSET);
+
+	memset (table, 0, LZ_WORK_SIZE);
+	while (end - ip >= LZ_MIN_MATCH) {
+		uint32_t seq = read32 (ip);
+		unsigned h = lz_hash (seq);
+		const uint8_t *ref = src + table[h];
+		size_t len;
+
+		table[h] = ip - src;
+		if (ref >= ip || read32 (ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		len = LZ_MIN_MATCH;
+		while (ip + len < end && ref[len] == ip[len])
+			len++;
+		op = put_sequence (op, oend, anchor, ip - anchor, ip - ref, len);
+		if (op == NULL)
+			return 0;
+		ip += len;
+		anchor = ip;
+	}
+
+	op = put_sequence (op, oend, anchor, end - anchor, 0, 0);
+	return op != NULL ? op - (uint8_t *) dst_ : 0;
+}
+
+/* Reads an extended length starting at *IP, adding it to *LEN.  Returns
+   false if the input ends first. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *iend, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip >= iend)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Decompresses the SRC_LEN bytes at SRC, which must expand to exactly
+   DST_LEN bytes, into DST.  Returns false if SRC is malformed. */
+bool
+lz_decompress (const void *src_, size_t src_len, void *dst_, size_t dst_len) {
+	const uint8_t *ip = src_, *iend = ip + src_len;
+	uint8_t *dst = dst_, *op = dst, *oend = dst + dst_len;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+		size_t lit_len = token >> 4;
+		size_t match_len = token & 15;
+		size_t offset;
+
+		if (lit_len == 15 && !get_length (&ip, iend, &lit_len))
+			return false;
+		if ((size_t) (iend - ip) < lit_len || (size_t) (oend - op) < lit_len)
+			return false;
+		memcpy (op, ip, lit_len);
+		ip += lit_len;
+		op += lit_len;
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return false;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (match_len == 15 && !get_length (&ip, iend, &match_len))
+			return false;
+		match_len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| (size_t) (oend - op) < match_len)
+			return false;
+
+		/* The match may overlap the bytes it produces. */
+		for (; match_len > 0; match_len--, op++)
+			*op = op[-offset];
+	}
+	return op == oend;
+}
@@ -90,6 +90,11 @@ exec (const char *file) {
 	return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
+pid_t
+spawn (const char *cmd_line, const struct spawn_fd *fds, size_t fd_cnt) {
+	return (pid_t) syscall3 (SYS_SPAWN, cmd_line, fds, fd_cnt);
+}
+
 int
 wait (pid_t pid) {
 	return syscall1 (SYS_WAIT, pid);
@@ -140,6 +145,91 @@ close (int fd) {
 	syscall1 (SYS_CLOSE, fd);
 }
 
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+uring_setup (void *addr, unsigned entries, size_t buf_size) {
+	return syscall3 (SYS_URING_SETUP, addr, entries, buf_size);
+}
+
+int
+uring_enter (unsigned to_submit, unsigned min_complete) {
+	return syscall2 (SYS_URING_ENTER, to_submit, min_complete);
+}
+
+int
+sendfile (int out_fd, int in_fd, unsigned count) {
+	return syscall3 (SYS_SENDFILE, out_fd, in_fd, count);
+}
+
+int
+pipe (int fds[2]) {
+	return syscall2 (SYS_PIPE, fds, 0);
+}
+
+int
+pipe2 (int fds[2], int flags) {
+	return syscall2 (SYS_PIPE, fds, flags);
+}
+
+int
+shm_open (const char *name, size_t size) {
+	return syscall2 (SYS_SHM_OPEN, name, size);
+}
+
+bool
+shm_unlink (const char *name) {
+	return syscall1 (SYS_SHM_UNLINK, name);
+}
+
+int
+futex_wait (int *addr, int val) {
+	return syscall2 (SYS_FUTEX_WAIT, addr, val);
+}
+
+int
+futex_wake (int *addr, int cnt) {
+	return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+int
+fsync (int fd) {
+	return syscall1 (SYS_FSYNC, fd);
+}
+
+void
+sync (void) {
+	syscall0 (SYS_SYNC);
+}
+
+int
+getdents (int fd, struct dirent *ents, unsigned cnt) {
+	return syscall3 (SYS_GETDENTS, fd, ents, cnt);
+}
+
+int64_t
+ticks (void) {
+	return syscall0 (SYS_TICKS);
+}
+
 int
 dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
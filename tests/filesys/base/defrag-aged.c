@@ -0,0 +1,85 @@
+/* Ages the disk by growing eight files side by side, 4 kB at a
+   time, so that their runs move past one another, and then removing
+   every other file to leave holes.  Reads the survivors back again
+   and again while the defragmenter moves their data, checking that
+   every read sees the right contents, and reports the time the reads
+   take.  The reads block on the disk
+   often enough for the defragmenter to finish a pass; the .ck file
+   checks from its statistics that it did and that it moved data. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 8
+#define BLOCK_SIZE 4096
+#define BLOCK_CNT 16
+#define PASS_CNT 50
+
+static char buf[BLOCK_SIZE];
+static char expected[BLOCK_SIZE];
+
+static void
+fill (char *p, int file, int block)
+{
+  size_t i;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    p[i] = file * 37 + block * 11 + i;
+}
+
+void
+test_main (void)
+{
+  int fds[FILE_CNT];
+  char name[16];
+  int block, file, pass;
+  int64_t start;
+
+  for (file = 0; file < FILE_CNT; file++)
+    {
+      snprintf (name, sizeof name, "age%d", file);
+      if (!create (name, 0) || (fds[file] = open (name)) < 2)
+        fail ("create \"%s\"", name);
+    }
+  for (block = 0; block < BLOCK_CNT; block++)
+    for (file = 0; file < FILE_CNT; file++)
+      {
+        fill (buf, file, block);
+        if (write (fds[file], buf, BLOCK_SIZE) != BLOCK_SIZE)
+          fail ("write \"age%d\" block %d", file, block);
+      }
+  for (file = 0; file < FILE_CNT; file++)
+    close (fds[file]);
+  msg ("grew %d files", FILE_CNT);
+
+  for (file = 1; file < FILE_CNT; file += 2)
+    {
+      snprintf (name, sizeof name, "age%d", file);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+  msg ("removed every other file");
+
+  start = ticks ();
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (file = 0; file < FILE_CNT; file += 2)
+      {
+        int fd;
+
+        snprintf (name, sizeof name, "age%d", file);
+        if ((fd = open (name)) < 2)
+          fail ("open \"%s\"", name);
+        for (block = 0; block < BLOCK_CNT; block++)
+          {
+            fill (expected, file, block);
+            if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE
+                || memcmp (buf, expected, BLOCK_SIZE))
+              fail ("pass %d: \"%s\" block %d differs", pass, name, block);
+          }
+        close (fd);
+      }
+  msg_time (start, "read back %d files %d times", FILE_CNT / 2, PASS_CNT);
+}
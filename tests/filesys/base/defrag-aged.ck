@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 1, [<<'EOF']);
+(defrag-aged) begin
+(defrag-aged) grew 8 files
+(defrag-aged) removed every other file
+(defrag-aged) end
+EOF
+my ($stats) = grep (/^defrag: /, @output);
+fail "missing defragmenter statistics\n" if !defined $stats;
+my ($passes, $moved) = $stats =~ /^defrag: (\d+) passes, .* (\d+) sectors moved/
+  or fail "malformed defragmenter statistics: $stats\n";
+fail "defragmenter never finished a pass\n" if $passes < 1;
+fail "defragmenter moved no data\n" if $moved == 0;
+pass;
@@ -0,0 +1,37 @@
+/* Checks that cached lookups follow creates and removes: a name
+   that was looked up and found missing can be created and opened,
+   and a name that was opened and then removed can no longer be
+   opened.  Then opens one file 1,000 times, which after the first
+   lookup is answered from the directory entry cache. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 1000
+
+void
+test_main (void)
+{
+  int fd, i;
+
+  CHECK (open ("ghost") == -1, "open \"ghost\" fails");
+  CHECK (open ("ghost") == -1, "open \"ghost\" fails again");
+  CHECK (!remove ("ghost"), "remove \"ghost\" fails");
+  CHECK (create ("ghost", 0), "create \"ghost\"");
+  CHECK ((fd = open ("ghost")) > 1, "open \"ghost\"");
+  close (fd);
+  CHECK (!create ("ghost", 0), "create \"ghost\" again fails");
+  CHECK (remove ("ghost"), "remove \"ghost\"");
+  CHECK (open ("ghost") == -1, "open removed \"ghost\" fails");
+  CHECK (create ("ghost", 0), "create \"ghost\" again");
+
+  CHECK (create ("hot", 0), "create \"hot\"");
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      if ((fd = open ("hot")) < 2)
+        fail ("open \"hot\" #%d", i);
+      close (fd);
+    }
+  msg ("opened \"hot\" %d times", OPEN_CNT);
+}
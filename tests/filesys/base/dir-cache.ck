@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-cache) begin
+(dir-cache) open "ghost" fails
+(dir-cache) open "ghost" fails again
+(dir-cache) remove "ghost" fails
+(dir-cache) create "ghost"
+(dir-cache) open "ghost"
+(dir-cache) create "ghost" again fails
+(dir-cache) remove "ghost"
+(dir-cache) open removed "ghost" fails
+(dir-cache) create "ghost" again
+(dir-cache) create "hot"
+(dir-cache) opened "hot" 1000 times
+(dir-cache) end
+EOF
+pass;
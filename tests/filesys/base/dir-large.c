@@ -0,0 +1,58 @@
+/* Creates 5,000 empty files in the root directory, opens each of
+   them, and removes them again, reporting the time each pass takes.
+   With a hashed directory each step touches a bucket or two rather
+   than scanning every entry. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 5000
+
+void
+test_main (void)
+{
+  char name[16];
+  int i, fd;
+  int64_t start;
+
+  start = ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+    }
+  msg_time (start, "created %d files", FILE_CNT);
+
+  if (create ("file0", 0))
+    fail ("created \"file0\" twice");
+
+  start = ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      close (fd);
+    }
+  msg_time (start, "opened %d files", FILE_CNT);
+
+  start = ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+  msg_time (start, "removed %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i += 500)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (open (name) != -1)
+        fail ("opened removed \"%s\"", name);
+    }
+  CHECK (create ("file0", 0), "create \"file0\" again");
+}
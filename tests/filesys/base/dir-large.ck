@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 3, [<<'EOF']);
+(dir-large) begin
+(dir-large) create "file0" again
+(dir-large) end
+EOF
+pass;
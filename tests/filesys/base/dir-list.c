@@ -0,0 +1,98 @@
+/* Creates 5,000 files and lists the root directory twice, once with
+   readdir(), one name per call, and once with getdents(), many
+   entries per call.  Each listing must name every file exactly once.
+   Then resumes a getdents() listing from the cookie of an entry in
+   the middle of a batch.  Reports the time each listing takes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 5000
+#define BATCH 100
+
+static char seen[FILE_CNT];
+static struct dirent ents[BATCH];
+
+/* Marks the file named NAME seen in listing PASS.  The test's own
+   executable is in the directory too and is skipped. */
+static void
+see (const char *name, int pass)
+{
+  int i = atoi (name + 1);
+
+  if (!strcmp (name, "dir-list"))
+    return;
+  if (name[0] != 'l' || i < 0 || i >= FILE_CNT)
+    fail ("unexpected entry \"%s\"", name);
+  if (seen[i] == pass)
+    fail ("\"%s\" listed twice", name);
+  seen[i] = pass;
+}
+
+/* Checks that listing PASS named every file. */
+static void
+check_seen (int pass)
+{
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    if (seen[i] != pass)
+      fail ("\"l%d\" not listed", i);
+}
+
+void
+test_main (void)
+{
+  char name[READDIR_MAX_LEN + 1];
+  int dir_fd, fd, i, n;
+  unsigned cookie;
+  int64_t start;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "l%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+    }
+  msg ("created %d files", FILE_CNT);
+
+  CHECK ((dir_fd = open ("/")) > 1, "open \"/\"");
+  CHECK (isdir (dir_fd), "isdir \"/\"");
+
+  start = ticks ();
+  while (readdir (dir_fd, name))
+    see (name, 1);
+  check_seen (1);
+  msg_time (start, "readdir listed %d files", FILE_CNT);
+
+  seek (dir_fd, 0);
+  start = ticks ();
+  while ((n = getdents (dir_fd, ents, BATCH)) > 0)
+    for (i = 0; i < n; i++)
+      {
+        if (ents[i].d_type != DT_REG || ents[i].d_ino == 0)
+          fail ("bad entry for \"%s\"", ents[i].d_name);
+        see (ents[i].d_name, 2);
+      }
+  if (n < 0)
+    fail ("getdents failed");
+  check_seen (2);
+  msg_time (start, "getdents listed %d files", FILE_CNT);
+
+  seek (dir_fd, 0);
+  CHECK (getdents (dir_fd, ents, 10) == 10, "getdents 10 entries");
+  cookie = ents[4].d_off;
+  strlcpy (name, ents[5].d_name, sizeof name);
+  seek (dir_fd, cookie);
+  CHECK (getdents (dir_fd, ents, 1) == 1 && !strcmp (ents[0].d_name, name),
+         "resume from a cookie");
+  close (dir_fd);
+
+  CHECK ((fd = open ("l0")) > 1, "open \"l0\"");
+  CHECK (getdents (fd, ents, BATCH) == -1, "getdents on a file fails");
+  close (fd);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 2, [<<'EOF']);
+(dir-list) begin
+(dir-list) created 5000 files
+(dir-list) open "/"
+(dir-list) isdir "/"
+(dir-list) getdents 10 entries
+(dir-list) resume from a cookie
+(dir-list) open "l0"
+(dir-list) getdents on a file fails
+(dir-list) end
+EOF
+pass;
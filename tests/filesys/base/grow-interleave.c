@@ -0,0 +1,73 @@
+/* Grows two empty files side by side, appending 4 kB to each in
+   turn until both hold 256 kB, then reads each of them back
+   sequentially.  Each file's data stays in a single run on disk, so
+   the appends rely on the space reserved past each file's end to
+   avoid moving the data on every write. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 4096
+#define BLOCK_CNT 64
+
+static char buf[BLOCK_SIZE];
+
+static void
+fill (char *p, int file, int block)
+{
+  size_t i;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    p[i] = file * 101 + block * 7 + i;
+}
+
+static void
+check (const char *name, int file)
+{
+  static char expected[BLOCK_SIZE];
+  int fd, block;
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  CHECK (filesize (fd) == BLOCK_SIZE * BLOCK_CNT, "\"%s\" is %d bytes",
+         name, BLOCK_SIZE * BLOCK_CNT);
+  for (block = 0; block < BLOCK_CNT; block++)
+    {
+      if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read \"%s\" block %d", name, block);
+      fill (expected, file, block);
+      if (memcmp (buf, expected, BLOCK_SIZE))
+        fail ("\"%s\" block %d differs", name, block);
+    }
+  close (fd);
+  msg ("read back \"%s\"", name);
+}
+
+void
+test_main (void)
+{
+  const char *names[2] = {"grow-a", "grow-b"};
+  int fds[2];
+  int block, i;
+
+  for (i = 0; i < 2; i++)
+    {
+      CHECK (create (names[i], 0), "create \"%s\"", names[i]);
+      CHECK ((fds[i] = open (names[i])) > 1, "open \"%s\"", names[i]);
+    }
+
+  for (block = 0; block < BLOCK_CNT; block++)
+    for (i = 0; i < 2; i++)
+      {
+        fill (buf, i, block);
+        if (write (fds[i], buf, BLOCK_SIZE) != BLOCK_SIZE)
+          fail ("append block %d to \"%s\"", block, names[i]);
+      }
+  msg ("appended %d blocks to each file", BLOCK_CNT);
+
+  for (i = 0; i < 2; i++)
+    close (fds[i]);
+  for (i = 0; i < 2; i++)
+    check (names[i], i);
+}
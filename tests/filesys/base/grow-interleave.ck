@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-interleave) begin
+(grow-interleave) create "grow-a"
+(grow-interleave) open "grow-a"
+(grow-interleave) create "grow-b"
+(grow-interleave) open "grow-b"
+(grow-interleave) appended 64 blocks to each file
+(grow-interleave) open "grow-a"
+(grow-interleave) "grow-a" is 262144 bytes
+(grow-interleave) read back "grow-a"
+(grow-interleave) open "grow-b"
+(grow-interleave) "grow-b" is 262144 bytes
+(grow-interleave) read back "grow-b"
+(grow-interleave) end
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* Writes a 100 kB log file in 100-byte appends, reading back the
+   latest record and checking the file size as it goes, then reopens
+   the file and reads the whole log back sequentially.  Reports the
+   time each pass takes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RECORD_SIZE 100
+#define RECORD_CNT 1000
+
+static char record[RECORD_SIZE];
+static char buf[RECORD_SIZE];
+
+/* Fills RECORD with the contents of record number N. */
+static void
+make_record (int n)
+{
+  size_t i;
+
+  for (i = 0; i < RECORD_SIZE; i++)
+    record[i] = (char) (n * 7 + i);
+}
+
+void
+test_main (void)
+{
+  int fd, i;
+  int64_t start;
+
+  CHECK (create ("log", 0), "create \"log\"");
+  CHECK ((fd = open ("log")) > 1, "open \"log\"");
+  start = ticks ();
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      make_record (i);
+      if (write (fd, record, RECORD_SIZE) != RECORD_SIZE)
+        fail ("append record %d", i);
+      if (filesize (fd) != (i + 1) * RECORD_SIZE)
+        fail ("size after record %d is %d", i, filesize (fd));
+      if (i % 97 == 0)
+        {
+          seek (fd, i * RECORD_SIZE);
+          if (read (fd, buf, RECORD_SIZE) != RECORD_SIZE
+              || memcmp (buf, record, RECORD_SIZE))
+            fail ("read back record %d", i);
+        }
+    }
+  msg_time (start, "appended %d records", RECORD_CNT);
+  msg ("close \"log\"");
+  close (fd);
+
+  CHECK ((fd = open ("log")) > 1, "open \"log\"");
+  start = ticks ();
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      make_record (i);
+      if (read (fd, buf, RECORD_SIZE) != RECORD_SIZE
+          || memcmp (buf, record, RECORD_SIZE))
+        fail ("read record %d", i);
+    }
+  if (read (fd, buf, RECORD_SIZE) != 0)
+    fail ("read past end of log");
+  msg_time (start, "read %d records", RECORD_CNT);
+  msg ("close \"log\"");
+  close (fd);
+}
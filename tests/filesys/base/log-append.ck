@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 2, [<<'EOF']);
+(log-append) begin
+(log-append) create "log"
+(log-append) open "log"
+(log-append) close "log"
+(log-append) open "log"
+(log-append) close "log"
+(log-append) end
+EOF
+pass;
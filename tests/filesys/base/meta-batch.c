@@ -0,0 +1,5 @@
+/* Creates and removes files in a loop, with the journal committing
+   many of these operations at a time, and reports the time the loop
+   takes.  Then makes a file durable with fsync() and sync(). */
+
+#include "tests/filesys/base/meta-loop.inc"
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 1, [<<'EOF']);
+(meta-batch) begin
+(meta-batch) create "keep"
+(meta-batch) open "keep"
+(meta-batch) write "keep"
+(meta-batch) fsync "keep"
+(meta-batch) fsync console fails
+(meta-batch) sync
+(meta-batch) open "keep" again
+(meta-batch) "keep" is 16 bytes
+(meta-batch) end
+EOF
+pass;
@@ -0,0 +1,4 @@
+/* Runs the same loop as meta-batch with the kernel committing the
+   journal after every operation (-jsync), for comparison. */
+
+#include "tests/filesys/base/meta-loop.inc"
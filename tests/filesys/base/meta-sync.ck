@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 1, [<<'EOF']);
+(meta-sync) begin
+(meta-sync) create "keep"
+(meta-sync) open "keep"
+(meta-sync) write "keep"
+(meta-sync) fsync "keep"
+(meta-sync) fsync console fails
+(meta-sync) sync
+(meta-sync) open "keep" again
+(meta-sync) "keep" is 16 bytes
+(meta-sync) end
+EOF
+pass;
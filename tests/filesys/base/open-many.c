@@ -0,0 +1,47 @@
+/* Creates 2,000 files and keeps all of them open, then opens each
+   one a second time, so that every open() looks its inode up among
+   2,000 others already open.  Checks that both descriptors of a file
+   see the same data. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 2000
+
+static int fds[FILE_CNT];
+
+void
+test_main (void)
+{
+  char name[16];
+  int i, fd, value;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "open%d", i);
+      if (!create (name, sizeof i))
+        fail ("create \"%s\"", name);
+      if ((fds[i] = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      if (write (fds[i], &i, sizeof i) != sizeof i)
+        fail ("write \"%s\"", name);
+    }
+  msg ("%d files open", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "open%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" again", name);
+      if (read (fd, &value, sizeof value) != sizeof value || value != i)
+        fail ("read \"%s\"", name);
+      close (fd);
+    }
+  msg ("reopened %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    close (fds[i]);
+  msg ("closed %d files", FILE_CNT);
+}
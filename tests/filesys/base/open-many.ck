@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(open-many) begin
+(open-many) 2000 files open
+(open-many) reopened 2000 files
+(open-many) closed 2000 files
+(open-many) end
+EOF
+pass;
@@ -0,0 +1,90 @@
+/* Creates 1,000 tiny files, writes and reads back each one, then
+   grows one of them well past what fits in its inode and checks that
+   its old contents survive the move.  Finally removes every file.
+   Reports the time taken to create, verify and remove the files. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 1000
+
+static char buf[2048];
+static char data[2048];
+
+/* Fills P with SIZE bytes that depend on SEED. */
+static void
+fill (char *p, size_t size, int seed)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    p[i] = (char) (seed * 31 + i);
+}
+
+void
+test_main (void)
+{
+  char name[16];
+  size_t size;
+  int i, fd;
+  int64_t start;
+
+  start = ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "tiny%d", i);
+      size = i % 400 + 1;
+      fill (data, size, i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      if (write (fd, data, size) != (int) size)
+        fail ("write \"%s\"", name);
+      close (fd);
+    }
+  msg_time (start, "created %d files", FILE_CNT);
+
+  start = ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "tiny%d", i);
+      size = i % 400 + 1;
+      fill (data, size, i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      if (filesize (fd) != (int) size)
+        fail ("\"%s\" is %d bytes, expected %zu", name, filesize (fd), size);
+      if (read (fd, buf, sizeof buf) != (int) size
+          || memcmp (buf, data, size))
+        fail ("read \"%s\"", name);
+      close (fd);
+    }
+  msg_time (start, "verified %d files", FILE_CNT);
+
+  /* tiny399 holds 400 bytes; append enough to move it out of line. */
+  fill (data, sizeof data, 399);
+  if ((fd = open ("tiny399")) < 2)
+    fail ("open \"tiny399\"");
+  seek (fd, 400);
+  if (write (fd, data + 400, sizeof data - 400) != (int) sizeof data - 400)
+    fail ("append to \"tiny399\"");
+  seek (fd, 0);
+  if (read (fd, buf, sizeof buf) != (int) sizeof buf
+      || memcmp (buf, data, sizeof data))
+    fail ("read grown \"tiny399\"");
+  close (fd);
+  msg ("grew tiny399 to %zu bytes", sizeof data);
+
+  start = ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "tiny%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+  msg_time (start, "removed %d files", FILE_CNT);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 3, [<<'EOF']);
+(tiny-files) begin
+(tiny-files) grew tiny399 to 2048 bytes
+(tiny-files) end
+EOF
+pass;
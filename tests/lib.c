@@ -36,6 +36,25 @@ msg (const char *format, ...)
   va_end (args);
 }
 
+/* Logs the message followed by the number of timer ticks since
+   START, as returned by ticks().  Benchmarks report their times
+   this way; .ck files drop these lines with IGNORE_TIMES, since
+   they differ from run to run. */
+void
+msg_time (int64_t start, const char *format, ...) 
+{
+  char suffix[32];
+  va_list args;
+
+  if (quiet)
+    return;
+  snprintf (suffix, sizeof suffix, ": %lld ticks\n",
+            (long long) (ticks () - start));
+  va_start (args, format);
+  vmsg (format, args, suffix);
+  va_end (args);
+}
+
 void
 fail (const char *format, ...) 
 {
@@ -11,6 +11,7 @@ extern bool quiet;
 
 void msg (const char *, ...) PRINTF_FORMAT (1, 2);
 void fail (const char *, ...) PRINTF_FORMAT (1, 2) NO_RETURN;
+void msg_time (int64_t start, const char *, ...) PRINTF_FORMAT (2, 3);
 
 /* Takes an expression to test for SUCCESS and a message, which
    may include printf-style arguments.  Logs the message, then
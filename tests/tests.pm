@@ -164,6 +164,14 @@ sub compare_output {
 			&& !/^ esi=.* edi=.* esp=.* ebp=.*/
 			&& !/^ cs=.* ds=.* es=.* ss=.*/, @output);
     }
+    my $time_cnt = $options{IGNORE_TIMES};
+    if (defined $time_cnt) {
+	delete $options{IGNORE_TIMES};
+	my (@times) = grep (/^\([a-zA-Z0-9-_]+\) .*: \d+ ticks$/, @output);
+	fail "\u$run reported " . scalar (@times) . " times, "
+	  . "expected $time_cnt\n" if @times != $time_cnt;
+	@output = grep (!/^\([a-zA-Z0-9-_]+\) .*: \d+ ticks$/, @output);
+    }
     die "unknown option " . (keys (%options))[0] . "\n" if %options;
 
     my ($msg);
@@ -0,0 +1,35 @@
+/* Opens the same file more times than a small fixed table would
+   hold, checking that open() always hands out the lowest free
+   descriptor and that the highest one is still usable. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 300
+
+void
+test_main (void) 
+{
+  int fds[OPEN_CNT];
+  char byte;
+  int i;
+
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open #%d returned %d", i, fds[i]);
+      if (i > 0 && fds[i] != fds[i - 1] + 1)
+        fail ("open #%d returned %d after %d", i, fds[i], fds[i - 1]);
+    }
+  msg ("opened \"sample.txt\" %d times", OPEN_CNT);
+
+  CHECK (read (fds[OPEN_CNT - 1], &byte, 1) == 1, "read from last fd");
+
+  close (fds[OPEN_CNT / 2]);
+  CHECK (open ("sample.txt") == fds[OPEN_CNT / 2], "reopen reuses freed fd");
+
+  for (i = 0; i < OPEN_CNT; i++)
+    close (fds[i]);
+}
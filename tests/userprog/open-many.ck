@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) opened "sample.txt" 300 times
+(open-many) read from last fd
+(open-many) reopen reuses freed fd
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Checks non-blocking pipes: reading an empty pipe and writing a
+   full one fail at once, a pipe holds one page, closing the write
+   end gives end of file and writing without a reader fails. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[8192];
+
+void
+test_main (void) 
+{
+  int fds[2];
+  int n, total;
+
+  CHECK (pipe2 (fds, PIPE_NONBLOCK) == 0, "pipe2");
+  CHECK (read (fds[0], buf, 1) == -1, "read empty pipe");
+
+  total = 0;
+  while ((n = write (fds[1], buf, 1000)) > 0)
+    total += n;
+  msg ("pipe took %d bytes", total);
+  CHECK (write (fds[1], buf, 1) == -1, "write full pipe");
+
+  CHECK (read (fds[0], buf, sizeof buf) == total, "drain pipe");
+  CHECK (write (fds[1], "abc", 3) == 3, "write 3 bytes");
+  close (fds[1]);
+  CHECK (read (fds[0], buf, sizeof buf) == 3, "read 3 bytes");
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read end of file");
+  close (fds[0]);
+
+  CHECK (pipe (fds) == 0, "pipe");
+  close (fds[0]);
+  CHECK (write (fds[1], buf, 1) == -1, "write without a reader");
+  close (fds[1]);
+}
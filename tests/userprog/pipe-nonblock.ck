@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-nonblock) begin
+(pipe-nonblock) pipe2
+(pipe-nonblock) read empty pipe
+(pipe-nonblock) pipe took 4096 bytes
+(pipe-nonblock) write full pipe
+(pipe-nonblock) drain pipe
+(pipe-nonblock) write 3 bytes
+(pipe-nonblock) read 3 bytes
+(pipe-nonblock) read end of file
+(pipe-nonblock) pipe
+(pipe-nonblock) write without a reader
+(pipe-nonblock) end
+pipe-nonblock: exit(0)
+EOF
+pass;
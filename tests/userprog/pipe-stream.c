@@ -0,0 +1,74 @@
+/* Streams 1 MB through a pipe from a forked child for each of
+   several write sizes, while the parent reads in chunks of a size
+   that does not match any of them and checks every byte.  Reports
+   the time each write size takes and the time of the whole read. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SEGMENT (1024 * 1024)
+#define READ_SIZE 3000
+
+static const int write_sizes[] = {16, 256, 4096, 65536};
+#define SIZE_CNT (sizeof write_sizes / sizeof *write_sizes)
+
+static char buf[65536];
+
+static void
+writer (int fd)
+{
+  size_t i;
+  int pos = 0;
+
+  for (i = 0; i < SIZE_CNT; i++)
+    {
+      int size = write_sizes[i];
+      int end = pos + SEGMENT;
+      int64_t start = ticks ();
+
+      while (pos < end)
+        {
+          int j;
+          for (j = 0; j < size; j++)
+            buf[j] = (pos + j) % 251;
+          if (write (fd, buf, size) != size)
+            fail ("write of %d bytes failed", size);
+          pos += size;
+        }
+      msg_time (start, "wrote %d bytes in %d-byte writes", SEGMENT, size);
+    }
+}
+
+void
+test_main (void) 
+{
+  int fds[2];
+  int pid, n, pos;
+  int64_t start;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  if ((pid = fork ("writer")) == 0)
+    {
+      close (fds[0]);
+      writer (fds[1]);
+      exit (0);
+    }
+  close (fds[1]);
+
+  start = ticks ();
+  pos = 0;
+  while ((n = read (fds[0], buf, READ_SIZE)) > 0)
+    {
+      int j;
+      for (j = 0; j < n; j++)
+        if (buf[j] != (char) ((pos + j) % 251))
+          fail ("wrong byte at offset %d", pos + j);
+      pos += n;
+    }
+  if (pos != SEGMENT * (int) SIZE_CNT)
+    fail ("read %d bytes, expected %d", pos, SEGMENT * (int) SIZE_CNT);
+  msg_time (start, "read %d bytes", pos);
+  close (fds[0]);
+  CHECK (wait (pid) == 0, "wait for writer");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_TIMES => 5, [<<'EOF']);
+(pipe-stream) begin
+(pipe-stream) pipe
+writer: exit(0)
+(pipe-stream) wait for writer
+(pipe-stream) end
+pipe-stream: exit(0)
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Reads sample.txt with readv() and pread(), and writes it back
+   into a new file with writev() and pwrite(), checking that the
+   positional calls leave the file position alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEAD 16
+
+void
+test_main (void) 
+{
+  char head[HEAD], body[sizeof sample], buf[sizeof sample];
+  struct iovec iov[2];
+  size_t len = sizeof sample - 1;
+  int fd;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  iov[0].iov_base = head;
+  iov[0].iov_len = HEAD;
+  iov[1].iov_base = body;
+  iov[1].iov_len = sizeof body;
+  CHECK (readv (fd, iov, 2) == (int) len, "readv header and body");
+  if (memcmp (head, sample, HEAD) || memcmp (body, sample + HEAD, len - HEAD))
+    fail ("readv returned wrong data");
+  CHECK (tell (fd) == len, "readv advanced the position");
+
+  CHECK (pread (fd, buf, 10, 20) == 10, "pread 10 bytes at 20");
+  if (memcmp (buf, sample + 20, 10))
+    fail ("pread returned wrong data");
+  CHECK (tell (fd) == len, "pread kept the position");
+
+  CHECK (create ("copy", len), "create \"copy\"");
+  CHECK ((fd = open ("copy")) > 1, "open \"copy\"");
+  iov[0].iov_base = sample;
+  iov[0].iov_len = HEAD;
+  iov[1].iov_base = sample + HEAD;
+  iov[1].iov_len = len - HEAD;
+  CHECK (writev (fd, iov, 2) == (int) len, "writev header and body");
+  CHECK (pwrite (fd, "KAIST", 5, 1) == 5, "pwrite 5 bytes at 1");
+  CHECK (tell (fd) == len, "pwrite kept the position");
+  close (fd);
+
+  check_file ("copy", sample, len);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rw-vec) begin
+(rw-vec) open "sample.txt"
+(rw-vec) readv header and body
+(rw-vec) readv advanced the position
+(rw-vec) pread 10 bytes at 20
+(rw-vec) pread kept the position
+(rw-vec) create "copy"
+(rw-vec) open "copy"
+(rw-vec) writev header and body
+(rw-vec) pwrite 5 bytes at 1
+(rw-vec) pwrite kept the position
+(rw-vec) open "copy" for verification
+(rw-vec) verified contents of "copy"
+(rw-vec) close "copy"
+(rw-vec) end
+rw-vec: exit(0)
+EOF
+pass;
@@ -0,0 +1,28 @@
+/* Forks and reaps many short-lived children one after another.
+   Each child exits right away, so the run time is dominated by
+   process creation and teardown; the "Thread cache" line printed
+   at power off shows how many thread pages were recycled. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 128
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t pid = fork ("churn");
+      if (pid == 0)
+        exit (i);
+      if (pid == PID_ERROR)
+        fail ("fork #%d failed", i);
+      if (wait (pid) != i)
+        fail ("wrong exit status for child #%d", i);
+    }
+  msg ("forked and reaped %d children", CHILD_CNT);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-churn) begin
+(fork-churn) forked and reaped 128 children
+(fork-churn) end
+EOF
+pass;
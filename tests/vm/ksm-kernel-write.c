@@ -0,0 +1,56 @@
+/* Fills two pages with the same contents and waits for ksmd to
+   merge them, then read()s a file into one of them.  The kernel's
+   write must break the sharing like a user write would, leaving the
+   other page as it was. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+#define PAGE_SIZE 4096
+
+/* Disk reads to do while waiting for the pages to be merged.  Each
+   one blocks this process long enough for ksmd to run. */
+#define WAIT_READS 5000
+
+static char buf[3 * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *a = (char *) (((uintptr_t) buf + PAGE_SIZE - 1)
+                      & ~(uintptr_t) (PAGE_SIZE - 1));
+  char *b = a + PAGE_SIZE;
+  size_t size = strlen (sample);
+  char scratch[64];
+  int handle;
+  int i;
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    a[i] = b[i] = 'k' + i % 7;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  for (i = 0; i < WAIT_READS; i++)
+    {
+      if (get_phys_addr (a) == get_phys_addr (b))
+        break;
+      seek (handle, 0);
+      read (handle, scratch, sizeof scratch);
+    }
+  if (i == WAIT_READS)
+    fail ("pages were not merged");
+  msg ("pages merged");
+
+  seek (handle, 0);
+  CHECK (read (handle, a, size) == (int) size, "read \"sample.txt\"");
+  if (memcmp (a, sample, size))
+    fail ("read of \"sample.txt\" returned wrong data");
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (b[i] != 'k' + i % 7)
+      fail ("byte %d of the other page changed", i);
+  msg ("other page unchanged");
+  close (handle);
+}
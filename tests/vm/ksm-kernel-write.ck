@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-kernel-write) begin
+(ksm-kernel-write) open "sample.txt"
+(ksm-kernel-write) pages merged
+(ksm-kernel-write) read "sample.txt"
+(ksm-kernel-write) other page unchanged
+(ksm-kernel-write) end
+EOF
+pass;
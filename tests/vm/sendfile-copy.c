@@ -0,0 +1,86 @@
+/* Copies large.txt twice: once through a 4 kB user buffer, one
+   read() and one write() per block, and once with a single
+   sendfile() call that keeps the data in the kernel, and reports
+   the time each copy took.  Both copies must match the original.
+   Finally sends a short file to the console. */
+
+#include <string.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 4096
+
+static char buf[BLOCK_SIZE];
+static char buf2[BLOCK_SIZE];
+
+static void
+compare (const char *a_name, const char *b_name, int size)
+{
+  int a, b, ofs;
+
+  CHECK ((a = open (a_name)) > 1, "open \"%s\"", a_name);
+  CHECK ((b = open (b_name)) > 1, "open \"%s\"", b_name);
+  for (ofs = 0; ofs < size; ofs += BLOCK_SIZE)
+    {
+      int len = size - ofs < BLOCK_SIZE ? size - ofs : BLOCK_SIZE;
+      if (read (a, buf, len) != len || read (b, buf2, len) != len)
+        fail ("short read at offset %d", ofs);
+      if (memcmp (buf, buf2, len))
+        fail ("\"%s\" and \"%s\" differ near offset %d", a_name, b_name, ofs);
+    }
+  close (a);
+  close (b);
+  msg ("\"%s\" matches \"%s\"", b_name, a_name);
+}
+
+void
+test_main (void)
+{
+  static const char greeting[] = "sent to the console\n";
+  int in, out, size, calls;
+  int64_t start;
+
+  CHECK ((in = open ("large.txt")) > 1, "open \"large.txt\"");
+  size = filesize (in);
+
+  /* Copy in user space. */
+  CHECK (create ("copy-user", size), "create \"copy-user\"");
+  CHECK ((out = open ("copy-user")) > 1, "open \"copy-user\"");
+  start = ticks ();
+  for (calls = 1; ; calls += 2)
+    {
+      int bytes = read (in, buf, BLOCK_SIZE);
+      if (bytes <= 0)
+        break;
+      if (write (out, buf, bytes) != bytes)
+        fail ("write to \"copy-user\" failed");
+    }
+  msg_time (start, "user-space copy of %d bytes", size);
+  close (out);
+  msg ("user-space copy took %d calls", calls);
+
+  /* Copy in the kernel. */
+  seek (in, 0);
+  CHECK (create ("copy-kernel", size), "create \"copy-kernel\"");
+  CHECK ((out = open ("copy-kernel")) > 1, "open \"copy-kernel\"");
+  start = ticks ();
+  if (sendfile (out, in, size) != size)
+    fail ("sendfile copied a short count");
+  msg_time (start, "in-kernel copy of %d bytes", size);
+  close (out);
+  msg ("in-kernel copy took 1 call");
+  close (in);
+
+  compare ("large.txt", "copy-user", size);
+  compare ("large.txt", "copy-kernel", size);
+
+  CHECK (create ("greeting", sizeof greeting - 1), "create \"greeting\"");
+  CHECK ((in = open ("greeting")) > 1, "open \"greeting\"");
+  write (in, greeting, sizeof greeting - 1);
+  seek (in, 0);
+  if (sendfile (STDOUT_FILENO, in, BLOCK_SIZE) != sizeof greeting - 1)
+    fail ("sendfile to the console copied a short count");
+  close (in);
+}
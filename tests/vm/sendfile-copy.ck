@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 2, [<<'EOF']);
+(sendfile-copy) begin
+(sendfile-copy) open "large.txt"
+(sendfile-copy) create "copy-user"
+(sendfile-copy) open "copy-user"
+(sendfile-copy) user-space copy took 981 calls
+(sendfile-copy) create "copy-kernel"
+(sendfile-copy) open "copy-kernel"
+(sendfile-copy) in-kernel copy took 1 call
+(sendfile-copy) open "large.txt"
+(sendfile-copy) open "copy-user"
+(sendfile-copy) "copy-user" matches "large.txt"
+(sendfile-copy) open "large.txt"
+(sendfile-copy) open "copy-kernel"
+(sendfile-copy) "copy-kernel" matches "large.txt"
+(sendfile-copy) create "greeting"
+(sendfile-copy) open "greeting"
+sent to the console
+(sendfile-copy) end
+EOF
+pass;
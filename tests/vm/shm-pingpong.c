@@ -0,0 +1,105 @@
+/* Bounces a turn flag between two processes 1000 times, first
+   through a named shared memory segment with futexes and then
+   through a pair of pipes.  The child maps the segment by name at
+   a different address than its parent, so the futex must be keyed
+   on the segment rather than on the virtual address.  Finally
+   removes the segment's name. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 1000
+#define ADDR ((void *) 0x10000000)
+#define ADDR2 ((void *) 0x20000000)
+
+struct shared
+  {
+    int turn;                   /* 1: child's turn, 0: parent's. */
+    int count;                  /* Rounds the child has seen. */
+  };
+
+static void
+wait_turn (volatile struct shared *s, int turn)
+{
+  while (s->turn != turn)
+    futex_wait ((int *) &s->turn, !turn);
+}
+
+static void
+pass_turn (volatile struct shared *s, int turn)
+{
+  s->turn = turn;
+  futex_wake ((int *) &s->turn, 1);
+}
+
+static void
+pong_shm (void)
+{
+  volatile struct shared *s;
+  int fd, i;
+
+  fd = shm_open ("pingpong", 0);
+  if (fd < 2)
+    fail ("shm_open \"pingpong\" in child");
+  s = mmap (ADDR2, sizeof *s, 1, fd, 0);
+  if (s != ADDR2)
+    fail ("mmap \"pingpong\" in child");
+  for (i = 0; i < ROUNDS; i++)
+    {
+      wait_turn (s, 1);
+      s->count++;
+      pass_turn (s, 0);
+    }
+  exit (0);
+}
+
+static void
+pong_pipe (int in, int out)
+{
+  char c;
+  int i;
+
+  for (i = 0; i < ROUNDS; i++)
+    if (read (in, &c, 1) != 1 || write (out, &c, 1) != 1)
+      fail ("pipe round %d in child", i);
+  exit (0);
+}
+
+void
+test_main (void)
+{
+  volatile struct shared *s;
+  int ping[2], pong[2];
+  int fd, i;
+  pid_t pid;
+  char c = 'x';
+
+  CHECK ((fd = shm_open ("pingpong", sizeof *s)) > 1, "shm_open \"pingpong\"");
+  CHECK ((s = mmap (ADDR, sizeof *s, 1, fd, 0)) == ADDR, "mmap \"pingpong\"");
+
+  if ((pid = fork ("pong")) == 0)
+    pong_shm ();
+  for (i = 0; i < ROUNDS; i++)
+    {
+      pass_turn (s, 1);
+      wait_turn (s, 0);
+    }
+  if (wait (pid) != 0 || s->count != ROUNDS)
+    fail ("child saw %d rounds", s->count);
+  msg ("%d rounds through shared memory", ROUNDS);
+
+  if (pipe (ping) != 0 || pipe (pong) != 0)
+    fail ("pipe");
+  if ((pid = fork ("pong")) == 0)
+    pong_pipe (ping[0], pong[1]);
+  for (i = 0; i < ROUNDS; i++)
+    if (write (ping[1], &c, 1) != 1 || read (pong[0], &c, 1) != 1)
+      fail ("pipe round %d", i);
+  if (wait (pid) != 0)
+    fail ("pipe child failed");
+  msg ("%d rounds through pipes", ROUNDS);
+
+  CHECK (shm_unlink ("pingpong"), "shm_unlink \"pingpong\"");
+  CHECK (!shm_unlink ("pingpong"), "shm_unlink \"pingpong\" again must fail");
+}
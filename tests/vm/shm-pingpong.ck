@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-pingpong) begin
+(shm-pingpong) shm_open "pingpong"
+(shm-pingpong) mmap "pingpong"
+(shm-pingpong) 1000 rounds through shared memory
+(shm-pingpong) 1000 rounds through pipes
+(shm-pingpong) shm_unlink "pingpong"
+(shm-pingpong) shm_unlink "pingpong" again must fail
+(shm-pingpong) end
+EOF
+pass;
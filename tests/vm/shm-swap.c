@@ -0,0 +1,56 @@
+/* Fills an 8 MB shared memory segment, more than fits in the 10 MB
+   machine next to the kernel, so that its pages go out to swap.
+   A forked child checks every page and rewrites it; the parent
+   then checks that it sees the child's writes. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SEG_SIZE (8 * 1024 * 1024)
+#define PAGE_COUNT (SEG_SIZE / PAGE_SIZE)
+#define ADDR ((char *) 0x10000000)
+
+static void
+check_pages (const char *who, int delta)
+{
+  size_t i, j;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    for (j = 0; j < PAGE_SIZE; j += 512)
+      if (ADDR[i * PAGE_SIZE + j] != (char) (i + delta))
+        fail ("%s: page %zu holds %d", who, i, ADDR[i * PAGE_SIZE + j]);
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int fd;
+  pid_t pid;
+
+  CHECK ((fd = shm_open ("swapped", SEG_SIZE)) > 1, "shm_open \"swapped\"");
+  CHECK (mmap (ADDR, SEG_SIZE, 1, fd, 0) == ADDR, "mmap \"swapped\"");
+  for (i = 0; i < PAGE_COUNT; i++)
+    memset (ADDR + i * PAGE_SIZE, i, PAGE_SIZE);
+  check_pages ("parent", 0);
+  msg ("wrote %d pages", PAGE_COUNT);
+
+  if ((pid = fork ("child-swap")) == 0)
+    {
+      check_pages ("child", 0);
+      for (i = 0; i < PAGE_COUNT; i++)
+        memset (ADDR + i * PAGE_SIZE, i + 1, PAGE_SIZE);
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "wait for child");
+  check_pages ("parent", 1);
+  msg ("child's writes are visible");
+
+  munmap (ADDR);
+  close (fd);
+  CHECK (shm_unlink ("swapped"), "shm_unlink \"swapped\"");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-swap) begin
+(shm-swap) shm_open "swapped"
+(shm-swap) mmap "swapped"
+(shm-swap) wrote 2048 pages
+(shm-swap) wait for child
+(shm-swap) child's writes are visible
+(shm-swap) shm_unlink "swapped"
+(shm-swap) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Runs 4 child-linear processes at once, started with spawn()
+   instead of fork() and exec().  Comparing its run time with that
+   of page-parallel shows what skipping the address space copy
+   saves.  Also checks that a missing executable and a bad fd
+   remapping list make spawn() fail. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void)
+{
+  struct spawn_fd bad_fd = { 2, 99 };
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK ((children[i] = spawn ("child-linear", NULL, 0)) != PID_ERROR,
+           "spawn child %d", i);
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+
+  CHECK (spawn ("child-linear", &bad_fd, 1) == PID_ERROR,
+         "spawn with unopened fd");
+  msg ("spawn missing program");
+  CHECK (spawn ("no-such-file", NULL, 0) == PID_ERROR,
+         "spawn returned error");
+}
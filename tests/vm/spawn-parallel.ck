@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(spawn-parallel) begin
+(spawn-parallel) spawn child 0
+(spawn-parallel) spawn child 1
+(spawn-parallel) spawn child 2
+(spawn-parallel) spawn child 3
+(spawn-parallel) wait for child 0
+(spawn-parallel) wait for child 1
+(spawn-parallel) wait for child 2
+(spawn-parallel) wait for child 3
+(spawn-parallel) spawn with unopened fd
+(spawn-parallel) spawn missing program
+load: no-such-file: open failed
+(spawn-parallel) spawn returned error
+(spawn-parallel) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Fills more anonymous memory than fits in RAM with data that does
+ * not compress, then reads all of it back several times.  After the
+ * first pass the pages are clean, so evicting them again should not
+ * need any swap writes.  The kernel reports how many writes the swap
+ * cache avoided when it powers off. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define CHUNK_SIZE (12 * ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define PASSES 3
+
+static uint32_t big_chunk[CHUNK_SIZE / sizeof (uint32_t)];
+
+/* Returns the word at index I of page PAGE. */
+static uint32_t
+value_of (size_t page, size_t i)
+{
+  uint32_t x = page * 2654435761u + i * 40503u + 1;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+void
+test_main (void)
+{
+  const size_t words = PAGE_SIZE / sizeof (uint32_t);
+  size_t page, i;
+  int pass;
+
+  msg ("fill %d pages", PAGE_COUNT);
+  for (page = 0; page < PAGE_COUNT; page++)
+    for (i = 0; i < words; i++)
+      big_chunk[page * words + i] = value_of (page, i);
+
+  for (pass = 0; pass < PASSES; pass++)
+    {
+      msg ("read pass %d", pass);
+      for (page = 0; page < PAGE_COUNT; page++)
+        for (i = 0; i < words; i += 64)
+          if (big_chunk[page * words + i] != value_of (page, i))
+            fail ("data is inconsistent in page %zu", page);
+    }
+}
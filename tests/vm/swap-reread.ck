@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-reread) begin
+(swap-reread) fill 3072 pages
+(swap-reread) read pass 0
+(swap-reread) read pass 1
+(swap-reread) read pass 2
+(swap-reread) end
+EOF
+pass;
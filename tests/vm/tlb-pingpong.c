@@ -0,0 +1,49 @@
+/* Two processes take turns touching a working set of pages, so every
+   context switch lands in an address space whose translations were
+   loaded a moment ago.  With PCIDs the TLB entries survive the
+   switch.  The kernel reports the number and cost of the switches when
+   it powers off; compare against a run with -no-pcid. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 64
+#define ROUNDS 20000
+
+static char working_set[PAGE_CNT * PAGE_SIZE];
+
+/* Reads one byte of every page, ROUNDS times, and returns their sum. */
+static int
+touch (void)
+{
+  int sum = 0;
+  int round;
+  size_t i;
+
+  for (round = 0; round < ROUNDS; round++)
+    for (i = 0; i < PAGE_CNT; i++)
+      sum += working_set[i * PAGE_SIZE];
+  return sum;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    working_set[i * PAGE_SIZE] = 1;
+
+  child = fork ("child");
+  if (child == 0)
+    exit (touch () == ROUNDS * PAGE_CNT ? 0 : 1);
+
+  if (touch () != ROUNDS * PAGE_CNT)
+    fail ("parent read wrong data");
+  if (wait (child) != 0)
+    fail ("child read wrong data");
+  msg ("both processes done");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(tlb-pingpong) begin
+(tlb-pingpong) both processes done
+(tlb-pingpong) end
+EOF
+pass;
@@ -0,0 +1,89 @@
+/* Issues 1,000 small reads of sample.txt twice: once with pread(),
+   one system call each, and once through the asynchronous I/O
+   rings, 32 at a time.  Both must return the same data.  Reports the
+   time each pass took; the "uring" line printed at power off shows
+   how few system calls the second pass took. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define READ_CNT 1000
+#define READ_SIZE 16
+#define ENTRIES 32
+#define RING ((struct uring *) 0x10000000)
+#define BUFS ((char *) RING + 4096)
+
+static char expected[READ_CNT][READ_SIZE];
+
+static off_t
+offset_of (int i, int size)
+{
+  return (i * 37) % (size - READ_SIZE);
+}
+
+void
+test_main (void)
+{
+  struct uring *ring = RING;
+  int free_slots[ENTRIES], free_cnt = 0;
+  int fd, size, i, next, done;
+  int64_t start;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  size = filesize (fd);
+
+  start = ticks ();
+  for (i = 0; i < READ_CNT; i++)
+    if (pread (fd, expected[i], READ_SIZE, offset_of (i, size)) != READ_SIZE)
+      fail ("pread #%d failed", i);
+  msg_time (start, "%d reads with pread", READ_CNT);
+
+  CHECK (uring_setup (RING, ENTRIES, ENTRIES * READ_SIZE) == 0,
+         "uring_setup");
+  for (i = 0; i < ENTRIES; i++)
+    free_slots[free_cnt++] = i;
+
+  start = ticks ();
+  next = done = 0;
+  while (done < READ_CNT)
+    {
+      int queued = 0;
+
+      /* Fill the SQ, one buffer slot per read in flight. */
+      while (next < READ_CNT && free_cnt > 0)
+        {
+          struct uring_sqe *sqe = &ring->sq[ring->sq_tail % ENTRIES];
+          int slot = free_slots[--free_cnt];
+
+          sqe->opcode = URING_READ;
+          sqe->fd = fd;
+          sqe->addr = BUFS + slot * READ_SIZE;
+          sqe->len = READ_SIZE;
+          sqe->off = offset_of (next, size);
+          sqe->user_data = (uint64_t) next * ENTRIES + slot;
+          ring->sq_tail++;
+          next++;
+          queued++;
+        }
+      uring_enter (queued, 1);
+
+      /* Reap whatever has completed. */
+      while (ring->cq_head != ring->cq_tail)
+        {
+          struct uring_cqe *cqe = &ring->cq[ring->cq_head % (2 * ENTRIES)];
+          int id = cqe->user_data / ENTRIES;
+          int slot = cqe->user_data % ENTRIES;
+
+          if (cqe->res != READ_SIZE)
+            fail ("read #%d returned %d", id, cqe->res);
+          if (memcmp (BUFS + slot * READ_SIZE, expected[id], READ_SIZE))
+            fail ("read #%d returned wrong data", id);
+          free_slots[free_cnt++] = slot;
+          ring->cq_head++;
+          done++;
+        }
+    }
+  msg_time (start, "%d reads through the rings", READ_CNT);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_TIMES => 2, [<<'EOF']);
+(uring-read) begin
+(uring-read) open "sample.txt"
+(uring-read) uring_setup
+(uring-read) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Reads a file into a bss page that has been mapped to the shared
+   zero page, then checks that other untouched pages, in this
+   process and in a child, still read as zeros.  The kernel's write
+   must get a private copy of the page instead of going through the
+   read-only mapping into the zero page itself. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+#define PAGE_SIZE 4096
+
+static char buf[4 * PAGE_SIZE];
+
+/* Fails unless the PAGE_SIZE bytes at PAGE are all zero. */
+static void
+check_zero (const char *page, const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (page[i] != 0)
+      fail ("byte %zu of %s page is %d, not 0", i, name, page[i]);
+}
+
+void
+test_main (void)
+{
+  char *page = (char *) (((uintptr_t) buf + PAGE_SIZE - 1)
+                         & ~(uintptr_t) (PAGE_SIZE - 1));
+  size_t size = strlen (sample);
+  int handle;
+  pid_t pid;
+
+  msg ("read-fault the first page");
+  check_zero (page, "first");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, page, size) == (int) size, "read \"sample.txt\"");
+  if (memcmp (page, sample, size))
+    fail ("read of \"sample.txt\" returned wrong data");
+  close (handle);
+
+  msg ("check the second page in the parent");
+  check_zero (page + PAGE_SIZE, "second");
+
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      check_zero (page + 2 * PAGE_SIZE, "third");
+      exit (81);
+    }
+  CHECK (pid != PID_ERROR, "fork");
+  CHECK (wait (pid) == 81, "child saw a zero page");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-page-read) begin
+(zero-page-read) read-fault the first page
+(zero-page-read) open "sample.txt"
+(zero-page-read) read "sample.txt"
+(zero-page-read) check the second page in the parent
+(zero-page-read) fork
+(zero-page-read) child saw a zero page
+(zero-page-read) end
+EOF
+pass;
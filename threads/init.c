@@ -27,6 +27,7 @@
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/uring.h"
 #endif
 #include "tests/threads/tests.h"
 #ifdef VM
@@ -36,6 +37,8 @@
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/journal.h"
+#include "filesys/defrag.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -51,6 +54,9 @@ bool power_off_when_done;
 
 bool thread_tests;
 
+/* -no-pcid: Tag TLB entries with process-context identifiers? */
+static bool use_pcid = true;
+
 static void bss_init (void);
 static void paging_init (uint64_t mem_end);
 
@@ -86,6 +92,7 @@ main (void) {
 	mem_end = palloc_init ();
 	malloc_init ();
 	paging_init (mem_end);
+	pcid_init (use_pcid);
 
 #ifdef USERPROG
 	tss_init ();
@@ -216,16 +223,30 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+		else if (!strcmp (name, "-jsync"))
+			journal_commit_each = true;
+		else if (!strcmp (name, "-defrag"))
+			defrag_enabled = true;
+		else if (!strcmp (name, "-stripe"))
+			filesys_stripe_chunk = atoi (value);
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-no-pcid"))
+			use_pcid = false;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-fa"))
+			vm_fault_around_enabled = true;
+		else if (!strcmp (name, "-reap"))
+			vm_reaper_enabled = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -326,8 +347,20 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -no-pcid           Flush the TLB on every address space switch.\n"
+#ifdef FILESYS
+			"  -jsync             Commit the file system journal after every operation.\n"
+			"  -defrag            Move file data next to its inode in the background.\n"
+			"  -stripe=CHUNK      Stripe the file system over hd0:1 and hd1:1 in\n"
+			"                     CHUNK-sector chunks.  With VM, swap uses the part\n"
+			"                     of hd1:1 past the size of hd0:1.\n"
+#endif
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -fa                Map neighbouring pages on file-backed faults.\n"
+			"  -reap              Free memory of exited processes in the background.\n"
 #endif
 			);
 	power_off ();
@@ -356,10 +389,16 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	filesys_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
+	pcid_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	uring_print_stats ();
+#endif
+#ifdef VM
+	vm_print_stats ();
 #endif
 }
@@ -1,7 +1,9 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
@@ -185,6 +187,147 @@ pdpe_destroy (uint64_t *pdpe) {
 	palloc_free_page ((void *) pdpe);
 }
 
+/* Process-context identifiers.
+
+   With CR4.PCIDE set, TLB entries are tagged with the PCID in the low
+   12 bits of CR3, and a CR3 load with bit 63 set keeps the entries of
+   every PCID.  Each pml4 that runs gets a PCID from a small table;
+   base_pml4 always uses PCID 0.  PCIDs are handed out in order, and when
+   they run out a new generation starts, forgetting every assignment.
+   A pml4 whose assignment was forgotten gets a fresh PCID on its next
+   activation, loaded without the no-flush bit so that any stale entries
+   for that PCID are dropped. */
+#define PCID_CNT 64                     /* PCIDs in use, counting 0. */
+#define CR3_NOFLUSH (1ULL << 63)        /* Keep TLB entries on CR3 load. */
+#define CR4_PCIDE (1ULL << 17)          /* Enable PCIDs. */
+#define CPUID_1_ECX_PCID (1u << 17)
+#define CPUID_7_EBX_INVPCID (1u << 10)
+
+static bool pcid_enabled;               /* CR4.PCIDE set? */
+static bool invpcid_supported;          /* INVPCID available? */
+static uint64_t *pcid_owner[PCID_CNT];  /* pml4 holding each PCID. */
+static size_t pcid_next = 1;            /* Next PCID to hand out. */
+
+/* Statistics. */
+static long long pcid_generation;       /* # of times PCIDs ran out. */
+static long long switch_cnt;            /* # of switches to a user pml4. */
+static long long noflush_cnt;           /* # of those that kept the TLB. */
+static long long shootdown_cnt;         /* # of entries invalidated remotely. */
+static long long switch_cycles;         /* TSC cycles spent in CR3 loads. */
+
+/* Turns on PCIDs if ENABLE is true and the CPU supports them. */
+void
+pcid_init (bool enable) {
+	uint32_t regs[4];
+
+	cpuid (0, 0, regs);
+	if (regs[0] >= 7) {
+		uint32_t max = regs[0];
+		cpuid (7, 0, regs);
+		invpcid_supported = max >= 7 && (regs[1] & CPUID_7_EBX_INVPCID);
+	}
+	cpuid (1, 0, regs);
+	if (!enable || !(regs[2] & CPUID_1_ECX_PCID))
+		return;
+
+	/* CR3 must hold PCID 0 while PCIDE is set. */
+	ASSERT ((rcr3 () & PTE_FLAGS) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Returns the PCID assigned to PML4, or 0 if it has none. */
+static size_t
+pcid_lookup (const uint64_t *pml4) {
+	size_t pcid;
+
+	for (pcid = 1; pcid < pcid_next; pcid++)
+		if (pcid_owner[pcid] == pml4)
+			return pcid;
+	return 0;
+}
+
+/* Forgets PML4's PCID, if it has one. */
+static void
+pcid_release (const uint64_t *pml4) {
+	enum intr_level old_level = intr_disable ();
+	size_t pcid = pcid_lookup (pml4);
+	if (pcid != 0)
+		pcid_owner[pcid] = NULL;
+	intr_set_level (old_level);
+}
+
+/* Returns the CR3 value that activates PML4. */
+static uint64_t
+pcid_cr3 (uint64_t *pml4) {
+	size_t pcid;
+
+	if (pml4 == base_pml4)
+		return vtop (pml4) | CR3_NOFLUSH;
+
+	switch_cnt++;
+	pcid = pcid_lookup (pml4);
+	if (pcid != 0) {
+		noflush_cnt++;
+		return vtop (pml4) | pcid | CR3_NOFLUSH;
+	}
+
+	if (pcid_next == PCID_CNT) {
+		memset (pcid_owner, 0, sizeof pcid_owner);
+		pcid_next = 1;
+		pcid_generation++;
+	}
+	pcid = pcid_next++;
+	pcid_owner[pcid] = pml4;
+	return vtop (pml4) | pcid;
+}
+
+/* Returns true if PML4 is the active page table. */
+static bool
+pml4_is_active (const uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* Invalidates the TLB entry for user virtual page UPAGE in PML4.  Entries
+ * of an inactive pml4 only survive a switch when PCIDs are in use; they
+ * are dropped with INVPCID, or else by forgetting the pml4's PCID. */
+static void
+tlb_invalidate (uint64_t *pml4, const void *upage) {
+	enum intr_level old_level;
+	size_t pcid;
+
+	if (pml4_is_active (pml4)) {
+		invlpg ((uint64_t) upage);
+		return;
+	}
+	if (!pcid_enabled)
+		return;
+
+	old_level = intr_disable ();
+	pcid = pcid_lookup (pml4);
+	if (pcid != 0) {
+		if (invpcid_supported)
+			invpcid (0, pcid, (uint64_t) upage);
+		else
+			pcid_owner[pcid] = NULL;
+		shootdown_cnt++;
+	}
+	intr_set_level (old_level);
+}
+
+/* Prints PCID statistics. */
+void
+pcid_print_stats (void) {
+	if (!pcid_enabled)
+		printf ("PCID: disabled, %lld switches", switch_cnt);
+	else
+		printf ("PCID: %lld switches, %lld without flush, %lld shootdowns, "
+				"%lld generations", switch_cnt, noflush_cnt, shootdown_cnt,
+				pcid_generation);
+	printf (", %lld cycles per switch\n",
+			switch_cnt ? switch_cycles / switch_cnt : 0);
+}
+
 /* Destroys pml4e, freeing all the pages it references. */
 void
 pml4_destroy (uint64_t *pml4) {
@@ -192,6 +335,9 @@ pml4_destroy (uint64_t *pml4) {
 		return;
 	ASSERT (pml4 != base_pml4);
 
+	if (pcid_enabled)
+		pcid_release (pml4);
+
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
@@ -203,7 +349,26 @@ pml4_destroy (uint64_t *pml4) {
  * register. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t start;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+	if (!pcid_enabled) {
+		if (pml4 == base_pml4) {
+			lcr3 (vtop (pml4));
+			return;
+		}
+		switch_cnt++;
+		start = rdtsc ();
+		lcr3 (vtop (pml4));
+	} else {
+		uint64_t cr3 = pcid_cr3 (pml4);
+		start = rdtsc ();
+		lcr3 (cr3);
+		if (pml4 == base_pml4)
+			return;
+	}
+	switch_cycles += rdtsc () - start;
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -238,8 +403,13 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		bool was_present = (*pte & PTE_P) != 0;
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		/* Replacing a mapping, e.g. on copy-on-write. */
+		if (was_present)
+			tlb_invalidate (pml4, upage);
+	}
 	return pte != NULL;
 }
 
@@ -257,8 +427,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, upage);
 	}
 }
 
@@ -283,8 +452,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -309,7 +477,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
@@ -42,6 +42,18 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Pages of dead threads kept for reuse by thread_create(), most
+   recently freed first, so a fork-heavy load does not go back to
+   the page allocator and zero a fresh page for every process.  Only
+   struct thread is cleared on reuse, by init_thread().  Holds at most
+   THREAD_CACHE_MAX pages; the rest are freed.  Accessed with
+   interrupts off. */
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+#define THREAD_CACHE_MAX 32
+static long long thread_cache_hits;   /* # of pages reused. */
+static long long thread_cache_misses; /* # of pages from palloc. */
+
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
@@ -116,6 +128,7 @@ thread_init (void) {
 	list_init (&ready_list);
 	list_init (&sleep_list);
 	list_init (&destruction_req);
+	list_init (&thread_cache);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
@@ -166,6 +179,41 @@ void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	printf ("Thread cache: %lld pages reused, %lld allocated, %zu cached\n",
+			thread_cache_hits, thread_cache_misses, thread_cache_cnt);
+}
+
+/* Returns a page for a new thread, from the cache if possible.  The
+   page's contents are garbage. */
+static struct thread *
+thread_page_get (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (!list_empty (&thread_cache)) {
+		t = list_entry (list_pop_front (&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+		thread_cache_hits++;
+	} else
+		thread_cache_misses++;
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Gives back the page of dead thread T, keeping it cached unless the
+   cache is at its high-water mark. */
+static void
+thread_page_put (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_cache_cnt < THREAD_CACHE_MAX) {
+		list_push_front (&thread_cache, &t->elem);
+		thread_cache_cnt++;
+	} else
+		palloc_free_page (t);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -192,7 +240,7 @@ thread_create (const char *name, int priority,
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO); /* 페이지 할당 */
+	t = thread_page_get (); /* 페이지 할당 */
 	if (t == NULL)
 		return TID_ERROR;
 
@@ -200,9 +248,6 @@ thread_create (const char *name, int priority,
 	init_thread (t, name, priority); /* thread 구조체 초기화*/
 	tid = t->tid = allocate_tid (); /* tid 할당 */
 
-	struct file **new_fdt = (struct file **)palloc_get_multiple(PAL_ZERO,3);
-	t->fdt = new_fdt;
-
 	/* Call the kernel_thread if it scheduled.
 	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
 	t->tf.rip = (uintptr_t) kernel_thread; /* 커널 스택 할당 */
@@ -496,7 +541,9 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->pre_priority = priority;
 	t->wait_on_lock = NULL;
 	t->exit_flag = 1;
-	t->next_fd = 2;
+#ifdef USERPROG
+	fdt_init (&t->fdt);
+#endif
 	list_init(&t->list_donation);
 	list_init(&t->child_list);
 	sema_init(&t->load_sema,0);
@@ -625,7 +672,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_put (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
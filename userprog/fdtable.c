@@ -0,0 +1,253 @@
+/* Per-process file descriptor tables.  See userprog/fdtable.h. */
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <round.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* FULL has one bit per bitmap word. */
+#if FD_MAX > 64 * 64
+#error FD_MAX must fit in 64 bitmap words
+#endif
+
+#define WORD_BITS 64
+#define ALL_USED (~(uint64_t) 0)
+
+static inline bool
+fdt_is_inline (const struct fd_table *t) {
+	return t->slots == t->inline_slots;
+}
+
+static inline int
+fdt_words (const struct fd_table *t) {
+	return DIV_ROUND_UP (t->cap, WORD_BITS);
+}
+
+/* Returns the taken slots of bitmap word W.  The inline word keeps
+ * its bits past FDT_INLINE set so that it reads as full when the
+ * inline slots are; those are masked out here. */
+static inline uint64_t
+fdt_word (const struct fd_table *t, int w) {
+	if (fdt_is_inline (t))
+		return t->used[w] & (((uint64_t) 1 << FDT_INLINE) - 1);
+	return t->used[w];
+}
+
+static void
+fdt_set (struct fd_table *t, int fd, struct file *file) {
+	int w = fd / WORD_BITS;
+
+	ASSERT (t->slots[fd] == NULL);
+	t->slots[fd] = file;
+	t->used[w] |= (uint64_t) 1 << (fd % WORD_BITS);
+	if (t->used[w] == ALL_USED)
+		t->full |= (uint64_t) 1 << w;
+}
+
+static void
+fdt_clear (struct fd_table *t, int fd) {
+	int w = fd / WORD_BITS;
+
+	t->slots[fd] = NULL;
+	t->used[w] &= ~((uint64_t) 1 << (fd % WORD_BITS));
+	t->full &= ~((uint64_t) 1 << w);
+}
+
+/* Returns the lowest free descriptor in T, or -1 if every slot of
+ * its current capacity is taken. */
+static int
+fdt_lowest_free (const struct fd_table *t) {
+	int words = fdt_words (t);
+	uint64_t avail = ~t->full;
+	int w;
+
+	if (words < WORD_BITS)
+		avail &= ((uint64_t) 1 << words) - 1;
+	if (avail == 0)
+		return -1;
+	w = __builtin_ctzll (avail);
+	return w * WORD_BITS + __builtin_ctzll (~t->used[w]);
+}
+
+/* Grows T to hold at least MIN_CAP slots, moving it to the heap.
+ * Returns false if MIN_CAP is past FD_MAX or memory runs out. */
+static bool
+fdt_grow (struct fd_table *t, int min_cap) {
+	int old_words = fdt_words (t);
+	struct file **slots;
+	uint64_t *used;
+	int cap, w;
+
+	cap = t->cap * 2 > min_cap ? t->cap * 2 : min_cap;
+	cap = ROUND_UP (cap, WORD_BITS);
+	if (cap > FD_MAX)
+		cap = FD_MAX;
+	if (cap < min_cap)
+		return false;
+
+	slots = calloc (cap, sizeof *slots);
+	used = calloc (DIV_ROUND_UP (cap, WORD_BITS), sizeof *used);
+	if (slots == NULL || used == NULL) {
+		free (slots);
+		free (used);
+		return false;
+	}
+	memcpy (slots, t->slots, t->cap * sizeof *slots);
+	t->full = 0;
+	for (w = 0; w < old_words; w++) {
+		used[w] = fdt_word (t, w);
+		if (used[w] == ALL_USED)
+			t->full |= (uint64_t) 1 << w;
+	}
+	if (!fdt_is_inline (t)) {
+		free (t->slots);
+		free (t->used);
+	}
+	t->slots = slots;
+	t->used = used;
+	t->cap = cap;
+	return true;
+}
+
+/* Resets T to an empty inline table. */
+static void
+fdt_reset (struct fd_table *t) {
+	memset (t->inline_slots, 0, sizeof t->inline_slots);
+	t->inline_used = ALL_USED << FDT_INLINE;
+	t->slots = t->inline_slots;
+	t->used = &t->inline_used;
+	t->full = 0;
+	t->cap = FDT_INLINE;
+}
+
+/* Initializes T with the console on STDIN_FILENO and STDOUT_FILENO.
+ * Allocates nothing. */
+void
+fdt_init (struct fd_table *t) {
+	fdt_reset (t);
+	fdt_set (t, STDIN_FILENO, FDT_STDIN);
+	fdt_set (t, STDOUT_FILENO, FDT_STDOUT);
+}
+
+/* Closes every descriptor in T and gives back its heap storage.
+ * T is left empty, without even the console. */
+void
+fdt_destroy (struct fd_table *t) {
+	for (int w = 0; w < fdt_words (t); w++) {
+		uint64_t bits = fdt_word (t, w);
+		while (bits != 0) {
+			int fd = w * WORD_BITS + __builtin_ctzll (bits);
+			bits &= bits - 1;
+			fdt_release (t->slots[fd]);
+		}
+	}
+	if (!fdt_is_inline (t)) {
+		free (t->slots);
+		free (t->used);
+	}
+	fdt_reset (t);
+}
+
+/* Replaces the contents of DST, a child's table, by a copy of SRC.
+ * Each open file is duplicated so the child gets its own position,
+ * except that descriptors sharing one file in SRC through dup2()
+ * share one duplicate in DST as well.  Returns false if out of
+ * memory, leaving DST partly filled. */
+bool
+fdt_copy (struct fd_table *dst, const struct fd_table *src) {
+	fdt_destroy (dst);
+	if (src->cap > dst->cap && !fdt_grow (dst, src->cap))
+		return false;
+
+	for (int w = 0; w < fdt_words (src); w++) {
+		uint64_t bits = fdt_word (src, w);
+		while (bits != 0) {
+			int fd = w * WORD_BITS + __builtin_ctzll (bits);
+			struct file *file = src->slots[fd];
+			struct file *copy = file;
+			bits &= bits - 1;
+
+			if (file > FDT_STDOUT) {
+				int alias = -1;
+				if (file_ref_cnt (file) > 1)
+					for (alias = 0; alias < fd; alias++)
+						if (src->slots[alias] == file)
+							break;
+				if (alias >= 0 && alias < fd)
+					copy = file_ref (dst->slots[alias]);
+				else
+					copy = file_duplicate (file);
+				if (copy == NULL)
+					return false;
+			}
+			fdt_set (dst, fd, copy);
+		}
+	}
+	return true;
+}
+
+/* Returns the file behind FD, which may be FDT_STDIN or FDT_STDOUT,
+ * or a null pointer if FD is not open. */
+struct file *
+fdt_get (const struct fd_table *t, int fd) {
+	if (fd < 0 || fd >= t->cap)
+		return NULL;
+	return t->slots[fd];
+}
+
+/* Installs FILE at the lowest free descriptor of T, which takes over
+ * the caller's reference.  Returns the descriptor, or -1 if T is at
+ * FD_MAX or cannot grow. */
+int
+fdt_install (struct fd_table *t, struct file *file) {
+	int fd = fdt_lowest_free (t);
+
+	if (fd < 0) {
+		if (!fdt_grow (t, t->cap + 1))
+			return -1;
+		fd = fdt_lowest_free (t);
+	}
+	fdt_set (t, fd, file);
+	return fd;
+}
+
+/* Installs FILE at descriptor FD of T, closing whatever FD referred
+ * to before.  T takes over the caller's reference.  Returns false if
+ * FD is out of range or T cannot grow. */
+bool
+fdt_install_at (struct fd_table *t, int fd, struct file *file) {
+	if (fd < 0 || fd >= FD_MAX)
+		return false;
+	if (fd >= t->cap && !fdt_grow (t, fd + 1))
+		return false;
+	if (t->slots[fd] != NULL)
+		fdt_release (fdt_remove (t, fd));
+	fdt_set (t, fd, file);
+	return true;
+}
+
+/* Removes FD from T and returns the reference it held, or a null
+ * pointer if FD was not open. */
+struct file *
+fdt_remove (struct fd_table *t, int fd) {
+	struct file *file = fdt_get (t, fd);
+
+	if (file != NULL)
+		fdt_clear (t, fd);
+	return file;
+}
+
+/* Takes another reference to FILE for a second descriptor. */
+struct file *
+fdt_share (struct file *file) {
+	return file > FDT_STDOUT ? file_ref (file) : file;
+}
+
+/* Drops a reference obtained from fdt_remove() or fdt_share(). */
+void
+fdt_release (struct file *file) {
+	if (file > FDT_STDOUT)
+		file_close (file);
+}
@@ -19,9 +19,11 @@
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "userprog/syscall.h"
+#include "userprog/uring.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 #include "threads/synch.h"
+#include "user/syscall.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -30,9 +32,12 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_spawn (void *);
+static bool process_load (char *file_name, struct intr_frame *if_);
 void argument_stack(char **parse, int count, void **rsp);
 int process_add_file (struct file *f);
 struct file *process_get_file(int fd);
+struct file *process_get_file_of(struct thread *t, int fd);
 void process_close_file(int fd);
 void remove_child_process(struct thread *cp);
 struct thread *get_child_process(int pid);
@@ -182,23 +187,9 @@ __do_fork (void *aux) {
 		goto error;
 #endif
 
-	if (parent->next_fd == FD_MAX)
-        goto error;
-
-    for (int i = 0; i < FD_MAX; i++)
-    {
-        struct file *file = parent->fdt[i];
-        if (file == NULL)
-            continue;
-        struct file *new_file;
-        if (file > FD_MIN)
-            new_file = file_duplicate(file);
-        else
-			new_file = file;
-        current->fdt[i] = new_file;
-    }
+	if (!fdt_copy (&current->fdt, &parent->fdt))
+		goto error;
 	if_.R.rax = 0;
-    current->next_fd = parent->next_fd;
 	process_init();
 	sema_up(&current->load_sema);
 	/* Finally, switch to the newly created process. */
@@ -225,26 +216,16 @@ struct thread *get_child_process(int pid)
 	return NULL;
 }
 
-/* Switch the current execution context to the f_name.
- * Returns -1 on fail. */
-int process_exec(void *f_name)
+/* Parses the command line in FILE_NAME, loads the executable it names
+ * into the current thread and pushes the arguments onto the new user
+ * stack described by IF_.  FILE_NAME is modified in place. */
+static bool
+process_load (char *file_name, struct intr_frame *if_)
 {
-    char *file_name = f_name;
-    bool success;
-    struct thread *cur = thread_current();
-
     //intr_frame 권한설정
-    struct intr_frame _if;
-    _if.ds = _if.es = _if.ss = SEL_UDSEG;
-    _if.cs = SEL_UCSEG;
-    _if.eflags = FLAG_IF | FLAG_MBS;
-
-    /* We first kill the current context */
-    process_cleanup();
-
-#ifdef VM
-	supplemental_page_table_init(&cur->spt);
-#endif
+    if_->ds = if_->es = if_->ss = SEL_UDSEG;
+    if_->cs = SEL_UCSEG;
+    if_->eflags = FLAG_IF | FLAG_MBS;
 
     // for argument parsing
     char *parse[128]; 
@@ -261,26 +242,167 @@ int process_exec(void *f_name)
     }
 
     /* And then load the binary */
-	success = load(file_name, &_if);
+	if (!load(file_name, if_))
+		return false;
 
-   /* If load failed, quit. */
-    if (!success)
-    {
-        palloc_free_page(file_name);
-        return -1;
-    }
+    argument_stack(parse, count, &if_->rsp);
+    if_->R.rdi = count;
+    if_->R.rsi = if_->rsp + 8;
+    return true;
+}
 
-    argument_stack(parse, count, &_if.rsp);
-    _if.R.rdi = count;
-    _if.R.rsi = _if.rsp + 8;
+/* Switch the current execution context to the f_name.
+ * Returns -1 on fail. */
+int process_exec(void *f_name)
+{
+    char *file_name = f_name;
+    bool success;
+    struct thread *cur = thread_current();
+    struct intr_frame _if;
+
+    /* We first kill the current context */
+    process_cleanup();
 
+#ifdef VM
+	supplemental_page_table_init(&cur->spt);
+#endif
+
+	success = process_load(file_name, &_if);
     palloc_free_page(file_name);
 
+   /* If load failed, quit. */
+    if (!success)
+        return -1;
+
     /* Start switched process. */
     do_iret(&_if);
     NOT_REACHED();
 }
 
+/* Arguments handed from process_spawn() to the new thread.  They live
+ * on the parent's stack, which stays put until the child ups its
+ * load_sema. */
+struct spawn_args {
+	struct thread *parent;
+	char *cmd_line;
+	const struct spawn_fd *fds;
+	size_t fd_cnt;
+};
+
+/* Installs the spawning parent's files into the current thread's fd
+ * table.  Without a remapping list every descriptor is inherited, as
+ * fork() would; otherwise only the listed parent fds are duplicated,
+ * each at its requested child fd. */
+static bool
+spawn_install_fds (struct thread *parent, const struct spawn_fd *fds,
+		size_t fd_cnt) {
+	struct thread *current = thread_current ();
+
+	if (fds == NULL)
+		return fdt_copy (&current->fdt, &parent->fdt);
+
+	for (size_t i = 0; i < fd_cnt; i++) {
+		int child_fd = fds[i].child_fd;
+		struct file *file = process_get_file_of (parent, fds[i].parent_fd);
+		struct file *copy;
+
+		if (child_fd < FD_MIN || fdt_get (&current->fdt, child_fd) != NULL
+				|| file == NULL)
+			return false;
+		copy = file_duplicate (file);
+		if (copy == NULL)
+			return false;
+		if (!fdt_install_at (&current->fdt, child_fd, copy)) {
+			file_close (copy);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Thread function of a spawned process.  Unlike __do_fork() nothing of
+ * the parent's address space is touched: the child starts from an
+ * empty page table and loads its executable directly. */
+static void
+__do_spawn (void *aux) {
+	struct spawn_args *args = aux;
+	struct thread *current = thread_current ();
+	struct intr_frame if_;
+
+	current->parent = args->parent;
+#ifdef VM
+	supplemental_page_table_init (&current->spt);
+#endif
+	if (!spawn_install_fds (args->parent, args->fds, args->fd_cnt))
+		goto error;
+	if (!process_load (args->cmd_line, &if_))
+		goto error;
+
+	/* ARGS is dead once the parent wakes up. */
+	process_init ();
+	sema_up (&current->load_sema);
+	do_iret (&if_);
+	NOT_REACHED ();
+error:
+	current->exit_flag = TID_ERROR;
+	sema_up (&current->load_sema);
+	thread_exit ();
+}
+
+/* Starts a new process running CMD_LINE as a child of the current
+ * one, without duplicating the caller's memory.  FDS, if not null,
+ * lists the FD_CNT descriptors the child receives; otherwise it
+ * inherits all of them.  Blocks only until the child's executable is
+ * loaded.  Returns the child's thread id, or TID_ERROR if the child
+ * could not be created or loaded. */
+tid_t
+process_spawn (const char *cmd_line, const struct spawn_fd *fds,
+		size_t fd_cnt) {
+	struct spawn_args args;
+	struct thread *child;
+	char name[16];
+	size_t len;
+	tid_t tid;
+
+	if (fds != NULL && fd_cnt > SPAWN_FD_MAX)
+		return TID_ERROR;
+
+	/* The command line takes the first half of the page and the
+	 * remapping list the second, so the child never reads user
+	 * memory of the parent. */
+	ASSERT (SPAWN_FD_MAX * sizeof *fds <= PGSIZE / 2);
+	args.parent = thread_current ();
+	args.cmd_line = palloc_get_page (0);
+	if (args.cmd_line == NULL)
+		return TID_ERROR;
+	strlcpy (args.cmd_line, cmd_line, PGSIZE / 2);
+	args.fds = NULL;
+	args.fd_cnt = 0;
+	if (fds != NULL) {
+		struct spawn_fd *copy = (void *) (args.cmd_line + PGSIZE / 2);
+		memcpy (copy, fds, fd_cnt * sizeof *fds);
+		args.fds = copy;
+		args.fd_cnt = fd_cnt;
+	}
+
+	cmd_line = args.cmd_line + strspn (args.cmd_line, " ");
+	len = strcspn (cmd_line, " ");
+	strlcpy (name, cmd_line, len + 1 < sizeof name ? len + 1 : sizeof name);
+
+	tid = thread_create (name, PRI_DEFAULT, __do_spawn, &args);
+	if (tid != TID_ERROR) {
+		child = get_child_process (tid);
+		sema_down (&child->load_sema);
+		if (child->exit_flag == TID_ERROR) {
+			/* Reap the failed child right away. */
+			process_wait (tid);
+			tid = TID_ERROR;
+		}
+	}
+	palloc_free_page (args.cmd_line);
+	return tid;
+}
+
 void argument_stack(char **parse, int count, void **rsp)
 {
     // Save argument strings (character by character)
@@ -317,29 +439,31 @@ void argument_stack(char **parse, int count, void **rsp)
 int process_add_file (struct file *f){
 
 	struct thread *cur = thread_current();
-	//파일 객체(struct file)를 가리키는 포인터를 File Descriptor 테이블에 추가
-	cur->fdt[cur->next_fd] = f;
-
-	//다음 File Descriptor 값 1 증가
-	cur->next_fd++;
-	//추가된 파일 객체의 File Descriptor 반환
-	return cur->next_fd-1;
+	//파일 객체(struct file)를 가리키는 포인터를 가장 낮은 빈 File Descriptor에 추가
+	return fdt_install(&cur->fdt, f);
 }
 
-struct file *process_get_file(int fd)
+/* Returns the open file behind T's descriptor FD, or a null pointer
+ * if FD is not open or refers to the console. */
+struct file *process_get_file_of(struct thread *t, int fd)
 {
-	struct thread *cur = thread_current();
-	if(fd < FD_MIN || fd > FD_MAX){
+	struct file *file = fdt_get(&t->fdt, fd);
+	if(file == FDT_STDIN || file == FDT_STDOUT){
 		return NULL;
 	}
-	return cur->fdt[fd];
+	return file;
+}
+
+struct file *process_get_file(int fd)
+{
+	return process_get_file_of(thread_current(), fd);
 }
+
+/* Closes FD of the current process.  The file itself stays open while
+ * another descriptor from dup2() refers to it. */
 void process_close_file(int fd){
 	struct thread *cur = thread_current();
-	if(fd < FD_MIN || fd >= FD_MAX){
-		return;
-	}
-	cur->fdt[fd] = NULL;
+	fdt_release(fdt_remove(&cur->fdt, fd));
 }
 void remove_child_process(struct thread *cp){
 	list_remove(&cp->child_elem);
@@ -373,11 +497,7 @@ int process_wait(tid_t child_tid UNUSED)
 void process_exit(void)
 {
 	struct thread *cur = thread_current();
-	for (int i = FD_MIN; i < FD_MAX; i++)
-		close(i);
-
-	palloc_free_multiple(cur->fdt, 3);
-	cur->fdt =  NULL;
+	fdt_destroy(&cur->fdt);
 
 	file_close(cur->running_file);
 	process_cleanup(); // pml4를 날림(이 함수를 call 한 thread의 pml4)
@@ -394,9 +514,10 @@ static void
 process_cleanup (void) {
 	struct thread *curr = thread_current ();
 
+	/* Workers may be using the ring pages until this returns. */
+	uring_destroy ();
 #ifdef VM
 	supplemental_page_table_kill(&curr->spt);
-	return;
 #endif
 	uint64_t *pml4;
 	/* Destroy the current process's page directory and switch back
@@ -10,12 +10,18 @@
 #include "threads/flags.h"
 #include "intrinsic.h"
 #include "filesys/filesys.h"
+#include "filesys/directory.h"
+#include "filesys/inode.h"
 #include "user/syscall.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "filesys/file.h"
 #include "userprog/process.h"
+#include "userprog/uring.h"
+#include "devices/disk.h"
+#include "devices/timer.h"
 #include <string.h>
+#include <limits.h>
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
@@ -24,6 +30,7 @@ void halt(void);
 void exit(int status);
 pid_t fork(const char *thread_name);
 int exec(const char *cmd_line);
+pid_t spawn(const char *cmd_line, const struct spawn_fd *fds, size_t fd_cnt);
 int wait(pid_t pid);
 bool create(const char *file, unsigned initial_size);
 bool remove(const char *file);
@@ -34,6 +41,22 @@ int write(int fd, const void *buffer, unsigned size);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
+int dup2(int oldfd, int newfd);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int pread(int fd, void *buffer, unsigned size, off_t offset);
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset);
+int sendfile(int out_fd, int in_fd, unsigned count);
+int pipe2(int fds[2], int flags);
+int shm_open(const char *name, size_t size);
+bool shm_unlink(const char *name);
+int fsync(int fd);
+void sync(void);
+bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
+bool isdir(int fd);
+int inumber(int fd);
+int getdents(int fd, struct dirent *ents, unsigned cnt);
+int64_t ticks(void);
 int process_add_file(struct file *f);
 struct file *process_get_file(int fd);
 struct page* check_address(void *addr);
@@ -67,6 +90,7 @@ void syscall_init(void)
 	write_msr(MSR_SYSCALL_MASK,
 			  FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 	lock_init(&filesys_lock);
+	uring_init();
 }
 
 /* The main system call interface */
@@ -90,6 +114,9 @@ void syscall_handler(struct intr_frame *f UNUSED)
 	case SYS_EXEC: /* Switch current process. */
 		f->R.rax = exec(f->R.rdi);
 		break;
+	case SYS_SPAWN: /* Start a process from an executable. */
+		f->R.rax = spawn(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
 	case SYS_WAIT: /* Wait for a child process to die. */
 		f->R.rax = wait(f->R.rdi);
 		break;
@@ -120,6 +147,66 @@ void syscall_handler(struct intr_frame *f UNUSED)
 	case SYS_CLOSE: /* Close a file. */
 		close(f->R.rdi);
 		break;
+	case SYS_READV: /* Read into several buffers. */
+		f->R.rax = readv(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_WRITEV: /* Write from several buffers. */
+		f->R.rax = writev(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_PREAD: /* Read at an offset. */
+		f->R.rax = pread(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_PWRITE: /* Write at an offset. */
+		f->R.rax = pwrite(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_SENDFILE: /* Copy between descriptors in the kernel. */
+		f->R.rax = sendfile(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_PIPE: /* Create a pipe. */
+		f->R.rax = pipe2(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_SHM_OPEN: /* Open a shared memory segment. */
+		f->R.rax = shm_open(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_SHM_UNLINK: /* Remove a shared memory segment's name. */
+		f->R.rax = shm_unlink(f->R.rdi);
+		break;
+	case SYS_FUTEX_WAIT: /* Sleep on a futex. */
+		f->R.rax = futex_wait(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_FUTEX_WAKE: /* Wake up futex sleepers. */
+		f->R.rax = futex_wake(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_FSYNC: /* Make a file's updates durable. */
+		f->R.rax = fsync(f->R.rdi);
+		break;
+	case SYS_SYNC: /* Make all file system updates durable. */
+		sync();
+		break;
+	case SYS_READDIR: /* Reads a directory entry. */
+		f->R.rax = readdir(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_ISDIR: /* Tests if a fd represents a directory. */
+		f->R.rax = isdir(f->R.rdi);
+		break;
+	case SYS_INUMBER: /* Returns the inode number for a fd. */
+		f->R.rax = inumber(f->R.rdi);
+		break;
+	case SYS_GETDENTS: /* Read many directory entries. */
+		f->R.rax = getdents(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_TICKS: /* Timer ticks since boot. */
+		f->R.rax = ticks();
+		break;
+	case SYS_URING_SETUP: /* Map asynchronous I/O rings. */
+		f->R.rax = uring_setup(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_URING_ENTER: /* Submit to and wait on the rings. */
+		f->R.rax = uring_enter(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_DUP2: /* Duplicate the file descriptor */
+		f->R.rax = dup2(f->R.rdi, f->R.rsi);
+		break;
 	case SYS_MMAP:
 		f->R.rax = mmap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
 		break;
@@ -206,6 +293,24 @@ int exec(const char *cmd_line)
 	return tid;
 }
 /*
+cmd_line을 실행하는 자식 프로세스를 부모의 메모리를 복제하지 않고 바로 만듭니다.
+fds가 NULL이 아니면 fd_cnt개의 (child_fd, parent_fd) 쌍에 있는 파일만 자식에게 넘기고,
+NULL이면 모든 파일을 물려줍니다. 자식의 로드가 끝날 때까지만 기다리며, 실패하면 -1을 반환합니다.
+*/
+pid_t spawn(const char *cmd_line, const struct spawn_fd *fds, size_t fd_cnt)
+{
+	check_address(cmd_line);
+	if (fds != NULL) {
+		if (fd_cnt > SPAWN_FD_MAX)
+			return -1;
+		if (fd_cnt > 0) {
+			check_address(fds);
+			check_address((char *) (fds + fd_cnt) - 1);
+		}
+	}
+	return process_spawn(cmd_line, fds, fd_cnt);
+}
+/*
 자식 프로세스 (pid) 를 기다려서 자식의 종료 상태(exit status)를 가져옵니다.
 만약 pid (자식 프로세스)가 아직 살아있으면, 종료 될 때 까지 기다립니다.
 종료가 되면 그 프로세스가 exit 함수로 전달해준 상태(exit status)를 반환합니다.
@@ -251,7 +356,8 @@ int read(int fd, void *buffer, unsigned size)
 	check_buffer(buffer, size, true);
     int file_size;
     char *read_buffer = buffer;
-    if (fd == 0)
+    struct file *read_file = fdt_get(&thread_current()->fdt, fd);
+    if (read_file == FDT_STDIN)
     {
         char key;
         for (file_size = 0; file_size < size; file_size++)
@@ -264,17 +370,17 @@ int read(int fd, void *buffer, unsigned size)
             }
         }
     }
-    else if (fd == 1)
+    else if (read_file == NULL || read_file == FDT_STDOUT)
     {
         return -1;
     }
+    else if (file_is_pipe(read_file))
+    {
+        /* 파이프는 상대편을 기다릴 수 있으므로 filesys_lock 없이 읽습니다. */
+        file_size = file_read(read_file, buffer, size);
+    }
     else
     {
-        struct file *read_file = process_get_file(fd);
-        if (read_file == NULL)
-        {	
-            return -1;
-        }
         lock_acquire(&filesys_lock);
 		file_size = file_read(read_file, buffer, size);
 		lock_release(&filesys_lock);
@@ -290,24 +396,407 @@ int write(int fd, const void *buffer, unsigned size)
 {
 	check_buffer(buffer, size, false);
 	int file_size;
-	if (fd == STDOUT_FILENO)
+	struct file *write_file = fdt_get(&thread_current()->fdt, fd);
+	if (write_file == FDT_STDOUT)
 	{
 		putbuf(buffer, size);
 		file_size = size;
 	}
-	else if(fd == STDIN_FILENO){
+	else if(write_file == NULL || write_file == FDT_STDIN){
 		return -1;
 	}
+	else if(file_is_pipe(write_file)){
+		file_size = file_write(write_file, buffer, size);
+	}
 	else{
-		if(process_get_file(fd) == NULL) 
-			return -1;
 		lock_acquire(&filesys_lock);
-		file_size = file_write(process_get_file(fd), buffer, size);
+		file_size = file_write(write_file, buffer, size);
 		lock_release(&filesys_lock);
 	}
 	return file_size;
 }
 
+/*
+iov 배열(iovcnt개)과 그 안의 모든 버퍼가 유효한지 확인하고 전체 길이를 반환합니다.
+iovcnt가 범위를 벗어나면 -1을 반환합니다.
+*/
+static int check_iovec(const struct iovec *iov, int iovcnt, bool writable)
+{
+	size_t total = 0;
+	if(iovcnt < 0 || iovcnt > IOV_MAX)
+		return -1;
+	if(iovcnt == 0)
+		return 0;
+	check_address(iov);
+	check_address((char *) (iov + iovcnt) - 1);
+	for(int i = 0; i < iovcnt; i++){
+		check_buffer(iov[i].iov_base, iov[i].iov_len, writable);
+		total += iov[i].iov_len;
+		if(total > INT_MAX)
+			return -1;
+	}
+	return total;
+}
+/*
+fd에서 읽은 데이터를 iov의 버퍼들에 차례대로 채웁니다.
+filesys_lock을 한 번만 잡고 현재 위치부터 이어서 읽은 뒤 위치를 한 번에 옮깁니다.
+읽은 바이트 수를 반환하며, 파일 끝에 닿으면 그 자리에서 멈춥니다.
+*/
+int readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	struct file *file = fdt_get(&thread_current()->fdt, fd);
+	int total = 0;
+	if(check_iovec(iov, iovcnt, true) < 0)
+		return -1;
+	if(file == FDT_STDIN){
+		for(int i = 0; i < iovcnt; i++)
+			total += read(fd, iov[i].iov_base, iov[i].iov_len);
+		return total;
+	}
+	if(file == NULL || file == FDT_STDOUT)
+		return -1;
+	if(file_is_pipe(file)){
+		for(int i = 0; i < iovcnt; i++){
+			off_t n = file_read(file, iov[i].iov_base, iov[i].iov_len);
+			if(n < 0)
+				return total > 0 ? total : -1;
+			total += n;
+			if((size_t) n < iov[i].iov_len)
+				break;
+		}
+		return total;
+	}
+
+	/* shm나 디렉터리처럼 inode가 없는 파일은 위치를 옮기며 읽을 수 없습니다. */
+	if(file_get_inode(file) == NULL)
+		return -1;
+
+	lock_acquire(&filesys_lock);
+	off_t pos = file_tell(file);
+	for(int i = 0; i < iovcnt; i++){
+		off_t n = file_read_at(file, iov[i].iov_base, iov[i].iov_len, pos);
+		if(n < 0)
+			break;
+		pos += n;
+		total += n;
+		if((size_t) n < iov[i].iov_len)
+			break;
+	}
+	file_seek(file, pos);
+	lock_release(&filesys_lock);
+	return total;
+}
+/*
+iov의 버퍼들을 차례대로 fd에 씁니다. readv와 같이 filesys_lock을 한 번만 잡습니다.
+쓴 바이트 수를 반환합니다.
+*/
+int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	struct file *file = fdt_get(&thread_current()->fdt, fd);
+	int total = 0;
+	if(check_iovec(iov, iovcnt, false) < 0)
+		return -1;
+	if(file == FDT_STDOUT){
+		for(int i = 0; i < iovcnt; i++){
+			putbuf(iov[i].iov_base, iov[i].iov_len);
+			total += iov[i].iov_len;
+		}
+		return total;
+	}
+	if(file == NULL || file == FDT_STDIN)
+		return -1;
+	if(file_is_pipe(file)){
+		for(int i = 0; i < iovcnt; i++){
+			off_t n = file_write(file, iov[i].iov_base, iov[i].iov_len);
+			if(n < 0)
+				return total > 0 ? total : -1;
+			total += n;
+			if((size_t) n < iov[i].iov_len)
+				break;
+		}
+		return total;
+	}
+
+	/* shm나 디렉터리처럼 inode가 없는 파일은 위치를 옮기며 쓸 수 없습니다. */
+	if(file_get_inode(file) == NULL)
+		return -1;
+
+	lock_acquire(&filesys_lock);
+	off_t pos = file_tell(file);
+	for(int i = 0; i < iovcnt; i++){
+		off_t n = file_write_at(file, iov[i].iov_base, iov[i].iov_len, pos);
+		if(n < 0)
+			break;
+		pos += n;
+		total += n;
+		if((size_t) n < iov[i].iov_len)
+			break;
+	}
+	file_seek(file, pos);
+	lock_release(&filesys_lock);
+	return total;
+}
+/*
+파일의 offset 위치부터 size 바이트를 읽습니다. 파일의 현재 위치는 바뀌지 않습니다.
+콘솔이나 열려있지 않은 fd, 음수 offset이면 -1을 반환합니다.
+*/
+int pread(int fd, void *buffer, unsigned size, off_t offset)
+{
+	check_buffer(buffer, size, true);
+	struct file *file = process_get_file(fd);
+	if(file == NULL || offset < 0)
+		return -1;
+	lock_acquire(&filesys_lock);
+	int bytes = file_read_at(file, buffer, size, offset);
+	lock_release(&filesys_lock);
+	return bytes;
+}
+/*
+buffer의 size 바이트를 파일의 offset 위치에 씁니다. 파일의 현재 위치는 바뀌지 않습니다.
+*/
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset)
+{
+	check_buffer(buffer, size, false);
+	struct file *file = process_get_file(fd);
+	if(file == NULL || offset < 0)
+		return -1;
+	lock_acquire(&filesys_lock);
+	int bytes = file_write_at(file, buffer, size, offset);
+	lock_release(&filesys_lock);
+	return bytes;
+}
+/*
+in_fd의 현재 위치부터 최대 count 바이트를 out_fd의 현재 위치로 커널 안에서 복사합니다.
+데이터는 유저 버퍼를 거치지 않고 한 페이지짜리 커널 버퍼를 통해 옮겨집니다.
+첫 조각만 섹터 경계까지 잘라 읽으므로 이후의 읽기는 모두 섹터 단위로 정렬되어
+inode_read_at()이 bounce buffer 없이 디스크에서 바로 읽습니다.
+out_fd가 콘솔(fd 1)이면 putbuf()로 출력하고, 파이프이면 파이프에 씁니다.
+in_fd는 파이프일 수 없습니다. 복사한 바이트 수를 반환하고, fd가 잘못되었거나
+한 바이트도 보내기 전에 읽기가 실패하면 -1을 반환합니다.
+*/
+int sendfile(int out_fd, int in_fd, unsigned count)
+{
+	struct file *in = process_get_file(in_fd);
+	struct file *out = fdt_get(&thread_current()->fdt, out_fd);
+	if(in == NULL || file_is_pipe(in) || out == NULL || out == FDT_STDIN)
+		return -1;
+	/* 파이프에 쓰는 동안에는 읽는 쪽을 기다릴 수 있으므로 filesys_lock을 놓습니다. */
+	bool out_locked = out != FDT_STDOUT && !file_is_pipe(out);
+	uint8_t *buf = palloc_get_page(0);
+	if(buf == NULL)
+		return -1;
+
+	int total = 0;
+	bool failed = false;
+	while(count > 0){
+		unsigned chunk = PGSIZE - file_tell(in) % DISK_SECTOR_SIZE;
+		if(chunk > count)
+			chunk = count;
+		lock_acquire(&filesys_lock);
+		off_t bytes = file_read(in, buf, chunk);
+		off_t written = bytes;
+		if(bytes > 0 && out_locked)
+			written = file_write(out, buf, bytes);
+		lock_release(&filesys_lock);
+		/* 파일 끝이거나 읽기에 실패하면 멈춥니다. */
+		if(bytes <= 0){
+			failed = bytes < 0;
+			break;
+		}
+		if(out == FDT_STDOUT)
+			putbuf((const char *) buf, bytes);
+		else if(!out_locked)
+			written = file_write(out, buf, bytes);
+		if(written < 0)
+			written = 0;
+		/* 쓰지 못한 만큼 읽은 위치를 되돌려 다음 호출이 이어받게 합니다. */
+		if(written < bytes){
+			lock_acquire(&filesys_lock);
+			file_seek(in, file_tell(in) - (bytes - written));
+			lock_release(&filesys_lock);
+		}
+		total += written;
+		count -= written;
+		if(written < (off_t) chunk)
+			break;
+	}
+	palloc_free_page(buf);
+	return failed && total == 0 ? -1 : total;
+}
+
+/*
+파이프를 만들어 읽는 쪽 fd를 fds[0]에, 쓰는 쪽 fd를 fds[1]에 넣습니다.
+flags에 PIPE_NONBLOCK이 있으면 두 끝 모두 상대를 기다리지 않습니다:
+빈 파이프에서 읽거나 가득 찬 파이프에 쓰면 바로 -1을 반환합니다.
+두 fd는 fork()와 spawn()으로 자식에게 물려줄 수 있습니다.
+성공하면 0을, 실패하면 -1을 반환합니다.
+*/
+int pipe2(int fds[2], int flags)
+{
+	struct file *ends[2];
+	int rfd, wfd;
+	check_buffer(fds, 2 * sizeof *fds, true);
+	if(flags & ~PIPE_NONBLOCK)
+		return -1;
+	if(!file_open_pipe(ends, flags & PIPE_NONBLOCK))
+		return -1;
+	rfd = process_add_file(ends[0]);
+	if(rfd == -1){
+		file_close(ends[0]);
+		file_close(ends[1]);
+		return -1;
+	}
+	wfd = process_add_file(ends[1]);
+	if(wfd == -1){
+		process_close_file(rfd);
+		file_close(ends[1]);
+		return -1;
+	}
+	fds[0] = rfd;
+	fds[1] = wfd;
+	return 0;
+}
+
+/*
+name이라는 이름의 공유 메모리 세그먼트를 열고 그 fd를 반환합니다.
+세그먼트가 없으면 size 바이트(페이지 단위로 올림)로 새로 만듭니다.
+fd는 mmap()으로만 쓸 수 있으며, 같은 세그먼트를 매핑한 프로세스들은 같은 물리 페이지를 봅니다.
+이미 있는 세그먼트보다 size가 크거나, 없는데 size가 0이면 -1을 반환합니다.
+*/
+int shm_open(const char *name, size_t size)
+{
+	check_address(name);
+	struct shm_segment *seg = shm_segment_open(name, size);
+	if(seg == NULL)
+		return -1;
+	struct file *file = file_open_shm(seg);
+	if(file == NULL)
+		return -1;
+	int fd = process_add_file(file);
+	if(fd == -1)
+		file_close(file);
+	return fd;
+}
+/*
+name이라는 공유 메모리 세그먼트의 이름을 지웁니다. 세그먼트는 열린 fd와 매핑이
+모두 사라질 때까지 남아 있지만, 이후의 shm_open()은 새 세그먼트를 만듭니다.
+*/
+bool shm_unlink(const char *name)
+{
+	check_address(name);
+	return shm_segment_unlink(name);
+}
+/*
+fd로 열린 파일에 지금까지 한 변경을 디스크에 확실히 남깁니다.
+메모리에 미뤄 둔 파일 데이터를 디스크에 쓰고, 저널에 모인 메타데이터를 커밋합니다.
+fd가 파일이 아니면 -1, 성공하면 0을 반환합니다.
+*/
+int fsync(int fd)
+{
+	struct file *sync_file = process_get_file(fd);
+	if(sync_file == NULL || file_get_inode(sync_file) == NULL)
+		return -1;
+	lock_acquire(&filesys_lock);
+	filesys_sync();
+	lock_release(&filesys_lock);
+	return 0;
+}
+/*
+파일 시스템에 지금까지 한 모든 변경을 디스크에 확실히 남깁니다.
+*/
+void sync(void)
+{
+	lock_acquire(&filesys_lock);
+	filesys_sync();
+	lock_release(&filesys_lock);
+}
+/*
+fd로 열린 디렉터리에서 다음 항목의 이름을 name에 씁니다.
+항목이 더 없거나 fd가 디렉터리가 아니면 false를 반환합니다.
+*/
+bool readdir(int fd, char name[READDIR_MAX_LEN + 1])
+{
+	check_buffer(name, READDIR_MAX_LEN + 1, true);
+	struct file *file = process_get_file(fd);
+	if(file == NULL || file_get_dir(file) == NULL)
+		return false;
+	char entry[NAME_MAX + 1];
+	lock_acquire(&filesys_lock);
+	bool found = dir_readdir(file_get_dir(file), entry);
+	lock_release(&filesys_lock);
+	if(found)
+		strlcpy(name, entry, READDIR_MAX_LEN + 1);
+	return found;
+}
+/*
+fd가 디렉터리를 가리키면 true를 반환합니다.
+*/
+bool isdir(int fd)
+{
+	struct file *file = process_get_file(fd);
+	return file != NULL && file_get_dir(file) != NULL;
+}
+/*
+fd가 가리키는 파일이나 디렉터리의 inode 번호(inode가 있는 섹터)를 반환합니다.
+fd가 파일 시스템의 파일이 아니면 -1을 반환합니다.
+*/
+int inumber(int fd)
+{
+	struct file *file = process_get_file(fd);
+	if(file == NULL)
+		return -1;
+	if(file_get_dir(file) != NULL)
+		return inode_get_inumber(dir_get_inode(file_get_dir(file)));
+	if(file_get_inode(file) == NULL)
+		return -1;
+	return inode_get_inumber(file_get_inode(file));
+}
+/*
+fd로 열린 디렉터리의 현재 위치부터 ents 배열(cnt개)을 채울 만큼 항목을 한 번에 읽습니다.
+readdir()처럼 항목마다 디렉터리를 다시 읽지 않고, 섹터를 한 번 읽어 그 안의 항목을 모두 꺼냅니다.
+각 항목의 d_off를 seek()에 넘기면 그 다음 항목부터 다시 읽을 수 있습니다.
+읽은 항목 수를, 끝에 닿았으면 0을, fd가 디렉터리가 아니면 -1을 반환합니다.
+*/
+int getdents(int fd, struct dirent *ents, unsigned cnt)
+{
+	struct file *file = process_get_file(fd);
+	if(file == NULL || file_get_dir(file) == NULL || cnt > INT_MAX / sizeof *ents)
+		return -1;
+	check_buffer(ents, cnt * sizeof *ents, true);
+	struct dir_record *records = palloc_get_page(0);
+	if(records == NULL)
+		return -1;
+
+	/* 유저 버퍼에 쓰다가 페이지 폴트가 날 수 있으므로 filesys_lock을 놓고 복사합니다. */
+	unsigned n = 0;
+	while(n < cnt){
+		size_t want = cnt - n;
+		if(want > PGSIZE / sizeof *records)
+			want = PGSIZE / sizeof *records;
+		lock_acquire(&filesys_lock);
+		size_t got = dir_getdents(file_get_dir(file), records, want);
+		lock_release(&filesys_lock);
+		for(size_t i = 0; i < got; i++, n++){
+			ents[n].d_ino = records[i].inumber;
+			ents[n].d_off = records[i].next;
+			ents[n].d_type = DT_REG;
+			strlcpy(ents[n].d_name, records[i].name, sizeof ents[n].d_name);
+		}
+		if(got < want)
+			break;
+	}
+	palloc_free_page(records);
+	return n;
+}
+
+/*
+부팅 이후 지난 타이머 틱 수를 반환합니다. 벤치마크가 걸린 시간을 재는 데 씁니다.
+*/
+int64_t ticks(void)
+{
+	return timer_ticks();
+}
+
 /*
 open file fd에서 읽거나 쓸 다음 바이트를 position으로 변경합니다.
 position은 파일 시작부터 바이트 단위로 표시됩니다.
@@ -320,7 +809,7 @@ void seek(int fd, unsigned position)
 	Use void file_seek(struct file *file, off_t new_pos).
 	*/	
 	struct file *seek_file = process_get_file(fd);
-	if(fd < 2){
+	if(seek_file == NULL){
 		return;
 	}
 	return file_seek(seek_file,position);
@@ -333,6 +822,8 @@ unsigned tell(int fd)
 {
 	//Use off_t file_tell(struct file *file).
 	struct file *tell_file = process_get_file(fd);
+	if(tell_file == NULL)
+		return -1;
 	return file_tell(tell_file);
 }
 /*
@@ -341,12 +832,27 @@ unsigned tell(int fd)
 */
 void close(int fd)
 {
-	struct file *close_file = process_get_file(fd);
-	if(close_file == NULL){
+	process_close_file(fd);
+}
+/*
+oldfd가 가리키는 파일을 newfd에도 연결합니다. newfd가 이미 열려 있었다면 먼저 닫습니다.
+두 식별자는 같은 파일 객체(위치 포함)를 공유하며, 둘 다 닫혀야 파일이 닫힙니다.
+성공하면 newfd를, oldfd가 열려 있지 않거나 newfd가 범위를 벗어나면 -1을 반환합니다.
+*/
+int dup2(int oldfd, int newfd)
+{
+	struct fd_table *fdt = &thread_current()->fdt;
+	struct file *file = fdt_get(fdt, oldfd);
+	if(file == NULL)
+		return -1;
+	if(oldfd == newfd)
+		return newfd;
+	file = fdt_share(file);
+	if(!fdt_install_at(fdt, newfd, file)){
+		fdt_release(file);
 		return -1;
 	}
-	process_close_file(fd);
-	return file_close(close_file);
+	return newfd;
 }
 /*
 주소 값이 유저 영역 주소 값인지 확인
@@ -386,8 +892,10 @@ void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 		exit(-1);
 
 	struct file *target = process_get_file(fd);
-	if(target == NULL) 
+	if(target == NULL || file_is_pipe(target))
 		return NULL;
+	if(file_get_shm(target) != NULL)
+		return shm_map(addr, length, writable, file_get_shm(target), offset);
 
 	return do_mmap(addr, length, writable, target, offset);
 }
@@ -0,0 +1,422 @@
+/* uring.c: Asynchronous I/O through rings shared with the process.
+ *
+ * uring_setup() maps a struct uring and a buffer area into the calling
+ * process as pinned anonymous pages (see vm_pin_page()), so the kernel
+ * can reach them through their kernel addresses from any thread.
+ * uring_enter() moves submission queue entries into a work list served
+ * by URING_WORKERS kernel threads, which post results to the completion
+ * queue.  NOP and OPEN, which need the process's own fd table, complete
+ * inline during uring_enter().
+ *
+ * The ring is writable by the process, so the kernel keeps its own copy
+ * of the queue sizes and of the indices it advances, and never trusts
+ * the ones in shared memory for anything but the process's own slots. */
+
+#include "userprog/uring.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "user/syscall.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/vm.h"
+
+/* Number of kernel threads executing requests. */
+#define URING_WORKERS 2
+
+/* Largest buffer area, in pages. */
+#define URING_BUF_PAGES 64
+
+/* Longest path URING_OPEN accepts, including the null terminator. */
+#define URING_PATH_MAX 128
+
+/* A process's rings. */
+struct uring_ctx {
+	struct uring *ring;          /* Kernel view of the ring page. */
+	unsigned sq_mask, cq_mask;   /* Queue sizes minus one. */
+	unsigned sq_head, cq_tail;   /* Indices advanced by the kernel. */
+	uint8_t *buf_uaddr;          /* User address of the buffer area. */
+	size_t buf_size;             /* Size of the buffer area in bytes. */
+	void **buf_kva;              /* Kernel view of each buffer page. */
+
+	struct lock lock;            /* Protects the members below and the CQ. */
+	struct condition done;       /* Signalled on every completion. */
+	unsigned inflight;           /* Submitted, not yet completed. */
+	unsigned writes;             /* URING_WRITEs among INFLIGHT. */
+	struct list fsyncs;          /* URING_FSYNCs waiting for WRITES. */
+};
+
+/* A request handed to the workers. */
+struct uring_req {
+	struct list_elem elem;
+	struct uring_ctx *ctx;
+	struct uring_sqe sqe;        /* Copy of the submission. */
+	struct file *file;           /* Reference held until completion. */
+};
+
+static struct list work_list;
+static struct lock work_lock;
+static struct semaphore work_sema;
+static bool workers_started;
+
+/* Statistics. */
+static long long enter_cnt;      /* # of uring_enter() calls. */
+static long long submit_cnt;     /* # of entries submitted. */
+static long long complete_cnt;   /* # of completions posted. */
+
+static void uring_worker (void *aux);
+
+void
+uring_init (void) {
+	ASSERT (sizeof (struct uring) <= PGSIZE);
+
+	list_init (&work_list);
+	lock_init (&work_lock);
+	sema_init (&work_sema, 0);
+}
+
+/* Appends a completion to CTX's CQ.  Room is reserved at submission
+ * time, so the CQ never overflows. */
+static void
+uring_post (struct uring_ctx *ctx, uint64_t user_data, int res) {
+	struct uring_cqe *cqe = &ctx->ring->cq[ctx->cq_tail & ctx->cq_mask];
+
+	ASSERT (lock_held_by_current_thread (&ctx->lock));
+	cqe->user_data = user_data;
+	cqe->res = res;
+	barrier ();
+	ctx->ring->cq_tail = ++ctx->cq_tail;
+	complete_cnt++;
+	cond_broadcast (&ctx->done, &ctx->lock);
+}
+
+/* Returns true if [UADDR, UADDR + LEN) lies in CTX's buffer area. */
+static bool
+uring_buf_ok (const struct uring_ctx *ctx, const void *uaddr, size_t len) {
+	const uint8_t *p = uaddr;
+	return p >= ctx->buf_uaddr && len <= ctx->buf_size
+		&& (size_t) (p - ctx->buf_uaddr) <= ctx->buf_size - len;
+}
+
+/* Returns the kernel address of byte OFS of CTX's buffer area. */
+static void *
+uring_buf_kva (const struct uring_ctx *ctx, size_t ofs) {
+	return (uint8_t *) ctx->buf_kva[ofs / PGSIZE] + ofs % PGSIZE;
+}
+
+/* Executes a URING_READ or URING_WRITE, one page of the buffer area at
+ * a time, and drops the request's file reference. */
+static int
+uring_rw (struct uring_req *req) {
+	const struct uring_ctx *ctx = req->ctx;
+	size_t ofs = (uint8_t *) req->sqe.addr - ctx->buf_uaddr;
+	unsigned left = req->sqe.len;
+	off_t pos = req->sqe.off;
+	int total = 0;
+
+	lock_acquire (&filesys_lock);
+	while (left > 0) {
+		unsigned chunk = PGSIZE - ofs % PGSIZE;
+		void *kva = uring_buf_kva (ctx, ofs);
+		off_t n;
+
+		if (chunk > left)
+			chunk = left;
+		if (req->sqe.opcode == URING_READ)
+			n = file_read_at (req->file, kva, chunk, pos);
+		else
+			n = file_write_at (req->file, kva, chunk, pos);
+		if (n <= 0) {
+			if (total == 0)
+				total = n;
+			break;
+		}
+		total += n;
+		if (n < (off_t) chunk)
+			break;
+		pos += n;
+		ofs += n;
+		left -= n;
+	}
+	file_close (req->file);
+	lock_release (&filesys_lock);
+	return total;
+}
+
+/* Posts the result RES of REQ, and of any fsync that was waiting for it,
+ * and frees REQ. */
+static void
+uring_complete (struct uring_req *req, int res) {
+	struct uring_ctx *ctx = req->ctx;
+
+	lock_acquire (&ctx->lock);
+	uring_post (ctx, req->sqe.user_data, res);
+	ctx->inflight--;
+	if (req->sqe.opcode == URING_WRITE && --ctx->writes == 0)
+		while (!list_empty (&ctx->fsyncs)) {
+			struct uring_req *fsync = list_entry (list_pop_front (&ctx->fsyncs),
+					struct uring_req, elem);
+			uring_post (ctx, fsync->sqe.user_data, 0);
+			ctx->inflight--;
+			free (fsync);
+		}
+	lock_release (&ctx->lock);
+	free (req);
+}
+
+/* Worker thread: executes requests from work_list forever. */
+static void
+uring_worker (void *aux UNUSED) {
+	for (;;) {
+		struct uring_req *req;
+
+		sema_down (&work_sema);
+		lock_acquire (&work_lock);
+		req = list_entry (list_pop_front (&work_list), struct uring_req, elem);
+		lock_release (&work_lock);
+		uring_complete (req, uring_rw (req));
+	}
+}
+
+/* Opens the path at SQE->addr for the current process.  Returns the new
+ * fd, or -1. */
+static int
+uring_open (const struct uring_ctx *ctx, const struct uring_sqe *sqe) {
+	size_t ofs = (uint8_t *) sqe->addr - ctx->buf_uaddr;
+	char path[URING_PATH_MAX];
+	struct file *file;
+	size_t i;
+	int fd;
+
+	if (!uring_buf_ok (ctx, sqe->addr, 1))
+		return -1;
+	for (i = 0; i < sizeof path && ofs + i < ctx->buf_size; i++) {
+		path[i] = *(char *) uring_buf_kva (ctx, ofs + i);
+		if (path[i] == '\0')
+			break;
+	}
+	if (i == sizeof path || ofs + i == ctx->buf_size)
+		return -1;
+
+	lock_acquire (&filesys_lock);
+	file = filesys_open (path);
+	lock_release (&filesys_lock);
+	if (file == NULL)
+		return -1;
+	fd = process_add_file (file);
+	if (fd < 0)
+		file_close (file);
+	return fd;
+}
+
+/* Starts executing SQE, a copy of a submission of the current process. */
+static void
+uring_submit (struct uring_ctx *ctx, const struct uring_sqe *sqe) {
+	struct uring_req *req;
+	struct file *file = NULL;
+	int res = -1;
+
+	submit_cnt++;
+	switch (sqe->opcode) {
+		case URING_NOP:
+			res = 0;
+			goto inline_done;
+		case URING_OPEN:
+			res = uring_open (ctx, sqe);
+			goto inline_done;
+		case URING_READ:
+		case URING_WRITE:
+			/* Pipes, shm segments and directories have no offsets to
+			 * read or write at. */
+			file = process_get_file (sqe->fd);
+			if (file == NULL || file_get_inode (file) == NULL
+					|| sqe->off < 0
+					|| !uring_buf_ok (ctx, sqe->addr, sqe->len))
+				goto inline_done;
+			break;
+		case URING_FSYNC:
+			if (process_get_file (sqe->fd) == NULL)
+				goto inline_done;
+			break;
+		default:
+			goto inline_done;
+	}
+
+	req = malloc (sizeof *req);
+	if (req == NULL)
+		goto inline_done;
+	req->ctx = ctx;
+	req->sqe = *sqe;
+	req->file = file != NULL ? file_ref (file) : NULL;
+
+	lock_acquire (&ctx->lock);
+	ctx->inflight++;
+	if (sqe->opcode == URING_FSYNC) {
+		/* Writes reach the disk when they complete, so an fsync only
+		 * has to wait for the writes in flight. */
+		if (ctx->writes == 0) {
+			ctx->inflight--;
+			uring_post (ctx, sqe->user_data, 0);
+			free (req);
+		} else
+			list_push_back (&ctx->fsyncs, &req->elem);
+		lock_release (&ctx->lock);
+		return;
+	}
+	if (sqe->opcode == URING_WRITE)
+		ctx->writes++;
+	lock_release (&ctx->lock);
+
+	lock_acquire (&work_lock);
+	list_push_back (&work_list, &req->elem);
+	lock_release (&work_lock);
+	sema_up (&work_sema);
+	return;
+
+inline_done:
+	lock_acquire (&ctx->lock);
+	uring_post (ctx, sqe->user_data, res);
+	lock_release (&ctx->lock);
+}
+
+/* Maps the current process's rings at ADDR: one page holding a struct
+ * uring with ENTRIES submission slots, followed by BUF_SIZE bytes of
+ * buffer area, rounded up to whole pages.  ADDR must be page-aligned
+ * and the whole range unmapped.  Returns 0 on success, -1 on failure. */
+int
+uring_setup (void *addr, unsigned entries, size_t buf_size) {
+	struct thread *cur = thread_current ();
+	size_t buf_pages = DIV_ROUND_UP (buf_size, PGSIZE);
+	struct uring_ctx *ctx;
+	uint8_t *va;
+	size_t i;
+
+	if (cur->uring != NULL || addr == NULL || pg_ofs (addr) != 0
+			|| entries == 0 || entries > URING_MAX_ENTRIES
+			|| (entries & (entries - 1)) != 0 || buf_pages > URING_BUF_PAGES)
+		return -1;
+	for (i = 0; i <= buf_pages; i++) {
+		va = (uint8_t *) addr + i * PGSIZE;
+		if (!is_user_vaddr (va) || spt_find_page (&cur->spt, va) != NULL)
+			return -1;
+	}
+
+	ctx = malloc (sizeof *ctx);
+	if (ctx == NULL)
+		return -1;
+	ctx->buf_kva = calloc (buf_pages + 1, sizeof *ctx->buf_kva);
+	ctx->ring = ctx->buf_kva != NULL ? vm_pin_page (addr) : NULL;
+	for (i = 0; ctx->ring != NULL && i < buf_pages; i++) {
+		ctx->buf_kva[i] = vm_pin_page ((uint8_t *) addr + (i + 1) * PGSIZE);
+		if (ctx->buf_kva[i] == NULL)
+			break;
+	}
+	if (ctx->ring == NULL || i < buf_pages) {
+		/* Pages mapped so far are freed with the address space. */
+		free (ctx->buf_kva);
+		free (ctx);
+		return -1;
+	}
+
+	ctx->sq_mask = entries - 1;
+	ctx->cq_mask = 2 * entries - 1;
+	ctx->sq_head = ctx->cq_tail = 0;
+	ctx->buf_uaddr = (uint8_t *) addr + PGSIZE;
+	ctx->buf_size = buf_pages * PGSIZE;
+	lock_init (&ctx->lock);
+	cond_init (&ctx->done);
+	ctx->inflight = ctx->writes = 0;
+	list_init (&ctx->fsyncs);
+	ctx->ring->sq_entries = entries;
+	ctx->ring->cq_entries = 2 * entries;
+
+	lock_acquire (&work_lock);
+	if (!workers_started) {
+		workers_started = true;
+		for (i = 0; i < URING_WORKERS; i++) {
+			tid_t tid = thread_create ("uringd", PRI_DEFAULT, uring_worker, NULL);
+			/* thread_create() filed the worker as our child; it is not. */
+			struct thread *worker = get_child_process (tid);
+			if (worker != NULL)
+				list_remove (&worker->child_elem);
+		}
+	}
+	lock_release (&work_lock);
+
+	cur->uring = ctx;
+	return 0;
+}
+
+/* Submits up to TO_SUBMIT entries from the current process's SQ, then
+ * waits until at least MIN_COMPLETE completions are in its CQ or
+ * nothing is in flight.  Stops submitting early if the CQ could not
+ * take another completion.  Returns the number of entries submitted,
+ * or -1 if the process has no rings. */
+int
+uring_enter (unsigned to_submit, unsigned min_complete) {
+	struct uring_ctx *ctx = thread_current ()->uring;
+	struct uring *ring;
+	unsigned submitted = 0;
+
+	if (ctx == NULL)
+		return -1;
+	ring = ctx->ring;
+	enter_cnt++;
+
+	if (to_submit > ctx->sq_mask + 1)
+		to_submit = ctx->sq_mask + 1;
+	while (submitted < to_submit && ctx->sq_head != ring->sq_tail) {
+		struct uring_sqe sqe;
+		bool room;
+
+		lock_acquire (&ctx->lock);
+		room = ctx->inflight + (ctx->cq_tail - ring->cq_head) <= ctx->cq_mask;
+		lock_release (&ctx->lock);
+		if (!room)
+			break;
+
+		sqe = ring->sq[ctx->sq_head & ctx->sq_mask];
+		ring->sq_head = ++ctx->sq_head;
+		uring_submit (ctx, &sqe);
+		submitted++;
+	}
+
+	lock_acquire (&ctx->lock);
+	while (ctx->cq_tail - ring->cq_head < min_complete && ctx->inflight > 0)
+		cond_wait (&ctx->done, &ctx->lock);
+	lock_release (&ctx->lock);
+	return submitted;
+}
+
+/* Waits for the current process's requests in flight and frees its
+ * rings' kernel state.  The ring pages go with the address space. */
+void
+uring_destroy (void) {
+	struct thread *cur = thread_current ();
+	struct uring_ctx *ctx = cur->uring;
+
+	if (ctx == NULL)
+		return;
+	lock_acquire (&ctx->lock);
+	while (ctx->inflight > 0)
+		cond_wait (&ctx->done, &ctx->lock);
+	lock_release (&ctx->lock);
+
+	cur->uring = NULL;
+	free (ctx->buf_kva);
+	free (ctx);
+}
+
+void
+uring_print_stats (void) {
+	printf ("uring: %lld entries submitted in %lld calls, %lld completed\n",
+			submit_cnt, enter_cnt, complete_cnt);
+}
@@ -2,11 +2,47 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "filesys/filesys.h"
 #include "lib/kernel/bitmap.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "vm/zswap.h"
+#include <stdio.h>
+#include <string.h>
 
 
 size_t page_in_disk = (PGSIZE/DISK_SECTOR_SIZE);
+
+/* Swap cache.  A page keeps its swap slot after it is read back, so the
+ * on-disk copy stays valid until the page is written to.  A page that
+ * is still clean when it is evicted again needs no write at all.
+ * While a page is being swapped out, its entry points at the frame
+ * being written so that a fault on the page is served from memory. */
+struct swap_cache_entry {
+	struct list_elem elem;
+	struct page *page;        /* Page being swapped out. */
+	const void *kva;          /* Its contents. */
+	bool rescued;             /* Faulted back in meanwhile? */
+};
+static struct list swap_cache;
+static struct lock swap_lock;   /* Protects swap_table, slot_refs and swap_cache. */
+
+/* Number of pages using each swap slot.  Pages that shared a frame
+ * are evicted together and share the slot their frame went to. */
+static unsigned *slot_refs;
+
+/* Statistics. */
+static long long swap_write_cnt;    /* # of pages written to disk. */
+static long long swap_read_cnt;     /* # of pages read from disk. */
+static long long clean_skip_cnt;    /* # of writes avoided for clean pages. */
+static long long rescue_cnt;        /* # of faults served during writeback. */
+
+/* First sector of swap_disk used for swap.  A striped file system
+ * keeps the ones before it. */
+static disk_sector_t swap_start;
+
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
 static bool anon_swap_in (struct page *page, void *kva);
@@ -25,8 +61,15 @@ void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
 	swap_disk = disk_get(1,1);
-	disk_sector_t dsize = disk_size(swap_disk) / page_in_disk;
+	swap_start = filesys_swap_start;
+	disk_sector_t dsize = (disk_size(swap_disk) - swap_start) / page_in_disk;
 	swap_table = bitmap_create(dsize);
+	slot_refs = calloc(dsize, sizeof *slot_refs);
+	if (slot_refs == NULL)
+		PANIC("swap slot table allocation failed");
+	list_init(&swap_cache);
+	lock_init(&swap_lock);
+	zswap_init();
 }
 
 /* Initialize the file mapping */
@@ -38,60 +81,234 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	struct anon_page *anon_page = &page->anon;
 	anon_page->thread = thread_current();
 	anon_page->idx = SIZE_MAX;
+	anon_page->zswap = NULL;
 	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Returns the swap cache entry for PAGE, if it is being swapped out.
+ * Must be called with swap_lock held. */
+static struct swap_cache_entry *
+swap_cache_find (struct page *page) {
+	struct list_elem *e;
+
+	for (e = list_begin(&swap_cache); e != list_end(&swap_cache); e = list_next(e)){
+		struct swap_cache_entry *sce = list_entry(e, struct swap_cache_entry, elem);
+		if (sce->page == page)
+			return sce;
+	}
+	return NULL;
+}
+
+/* Drops a reference to swap slot INDEX, which is freed with its last
+ * one.  Must be called with swap_lock held. */
+static void
+put_slot (size_t index) {
+	ASSERT(slot_refs[index] > 0);
+	if (--slot_refs[index] == 0)
+		bitmap_set(swap_table, index, false);
+}
+
+/* Releases the swap slot held by ANON_PAGE, if any. */
+static void
+anon_release_slot (struct anon_page *anon_page) {
+	if (anon_page->idx == -1)
+		return;
+	anon_free_slot(anon_page->idx);
+	anon_page->idx = -1;
+}
+
+/* Releases the swap slots and zswap entries of all anonymous pages in
+ * SPT_HASH, taking swap_lock only once.  Used when an address space is
+ * torn down.  The zswap entries go first: until then, zswap writeback
+ * may still move one of them to a fresh swap slot. */
+void
+anon_release_all (struct hash *spt_hash) {
+	struct hash_iterator i;
+
+	hash_first(&i, spt_hash);
+	while (hash_next(&i)){
+		struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+		if (VM_TYPE(page->operations->type) == VM_ANON)
+			zswap_free(page);
+	}
+
+	lock_acquire(&swap_lock);
+	hash_first(&i, spt_hash);
+	while (hash_next(&i)){
+		struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+		if (VM_TYPE(page->operations->type) != VM_ANON)
+			continue;
+		if (page->anon.idx != -1){
+			put_slot(page->anon.idx);
+			page->anon.idx = -1;
+		}
+	}
+	lock_release(&swap_lock);
+}
+
+/* Swap in the page by read contents from the swap disk.  The page keeps
+ * its slot, whose contents stay valid until the page is dirtied. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	struct swap_cache_entry *sce;
+
+	/* Still being swapped out: copy it from the old frame. */
+	lock_acquire(&swap_lock);
+	sce = swap_cache_find(page);
+	if(sce != NULL){
+		memcpy(kva, sce->kva, PGSIZE);
+		sce->rescued = true;
+		rescue_cnt++;
+		lock_release(&swap_lock);
+		return true;
+	}
+	lock_release(&swap_lock);
+
+	if(zswap_load(page, kva))
+		return true;
+
 	size_t index = anon_page->idx;
-	if(!bitmap_test(swap_table,index)){ //스왑 테이블에서 해당 인덱스가 사용하는지 확인,
+	lock_acquire(&swap_lock);
+	if(anon_page->idx == -1 || !bitmap_test(swap_table,index)){ //스왑 테이블에서 해당 인덱스가 사용하는지 확인,
+		lock_release(&swap_lock);
 		return false;
 	}
+	lock_release(&swap_lock);
+	anon_read_slot(index, kva);
+	return true;
+}
+
+/* Reads swap slot INDEX into the page at KVA. */
+void
+anon_read_slot (size_t index, void *kva) {
 	/*
 	디스크는 섹터 단위로 데이터 단위를 표시함.
 	페이지 사이즈가 섹터 크기보다 월등히 크기 때문에 페이지를 디스크에 저장하기 위해서는 페이지의 크기를 섹터의 크기만큼 나눠서 저장해야함.
 	*/
 	for(int i = 0; i < page_in_disk; i++){
 		// 스왑 디스크에서 페이지를 읽어와서 kva로 복사.
-		disk_read(swap_disk, (index * page_in_disk) + i, kva + (i * DISK_SECTOR_SIZE));
+		disk_read(swap_disk, swap_start + (index * page_in_disk) + i, kva + (i * DISK_SECTOR_SIZE));
 	}
-	//스왑 테이블에서 해당 안덱스를 사용하지 않음으로 변경.
-	bitmap_set(swap_table, index, false);
-	anon_page->idx = -1;
-	return true;
+	swap_read_cnt++;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
-static bool
-anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+/* Drops a reference to swap slot INDEX. */
+void
+anon_free_slot (size_t index) {
+	lock_acquire(&swap_lock);
+	put_slot(index);
+	lock_release(&swap_lock);
+}
+
+/* Makes PAGE, which has just been unmapped, use swap slot INDEX, which
+ * holds its contents, in place of any slot or zswap entry it had. */
+void
+anon_share_slot (struct page *page, size_t index) {
+	zswap_free(page);
+	anon_release_slot(&page->anon);
+	lock_acquire(&swap_lock);
+	slot_refs[index]++;
+	lock_release(&swap_lock);
+	page->anon.idx = index;
+}
+
+/* Writes the page at KVA to swap slot INDEX. */
+static void
+swap_write (size_t index, const void *kva) {
+	for(int i = 0; i < page_in_disk; i++){
+		//스왐 디스크에서 스왑디스크의 오프셋만큼, 물리메모리에 있는 페이지를 가리킨다.
+		disk_write(swap_disk, swap_start + (index * page_in_disk) + i, kva + (i * DISK_SECTOR_SIZE));
+	}
+	swap_write_cnt++;
+}
+
+/* Writes the page at KVA to a free swap slot and returns the slot, with
+ * one reference, or BITMAP_ERROR if the swap disk is full. */
+size_t
+anon_write_slot (const void *kva) {
 	// 스왑테이블에서 0부터 검색을시작, 사용중이지 않은 비트를 탐색.
-	size_t index = bitmap_scan(swap_table, 0, 1, false);
+	lock_acquire(&swap_lock);
+	size_t index = bitmap_scan_and_flip(swap_table, 0, 1, false);
+	if(index != BITMAP_ERROR)
+		slot_refs[index] = 1;
+	lock_release(&swap_lock);
 	if(index == BITMAP_ERROR){
-		return false;
+		return BITMAP_ERROR;
 	}
-	for(int i = 0; i < page_in_disk; i++){
-		//스왐 디스크에서 스왑디스크의 오프셋만큼, 물리메모리에 있는 페이지를 가리킨다.
-		disk_write(swap_disk, (index * page_in_disk) + i, page->frame->kva + (i * DISK_SECTOR_SIZE));
+	swap_write(index, kva);
+	return index;
+}
+
+/* Swap out the page.  A clean page whose swap slot is still valid is
+ * simply dropped; otherwise it is compressed into zswap or, failing
+ * that, written to the swap disk.  The page is unmapped first so that
+ * it cannot change while being written. */
+static bool
+anon_swap_out (struct page *page) {
+	struct anon_page *anon_page = &page->anon;
+	uint64_t *pml4 = anon_page->thread->pml4;
+	struct frame *frame = page->frame;
+	void *kva = frame->kva;
+	bool dirty = pml4_is_dirty(pml4, page->va);
+	struct swap_cache_entry sce;
+	bool success = true;
+
+	if(anon_page->idx != -1 && !dirty){
+		page->frame = NULL;
+		pml4_clear_page(pml4, page->va);
+		clean_skip_cnt++;
+		return true;
 	}
-	//해당 인덱스를 사용중으로 변경
-	bitmap_set(swap_table, index, true);
+
+	sce.page = page;
+	sce.kva = kva;
+	sce.rescued = false;
+	lock_acquire(&swap_lock);
+	list_push_back(&swap_cache, &sce.elem);
+	lock_release(&swap_lock);
 	//가상주소와의 매핑 제거.
-	pml4_set_dirty(anon_page->thread->pml4, page->va, false);
-	pml4_clear_page(anon_page->thread->pml4, page->va);
-	anon_page->idx = index;
 	page->frame = NULL;
-	return true;
+	pml4_clear_page(pml4, page->va);
+
+	anon_release_slot(anon_page);
+	if(!zswap_store(page, kva)){
+		size_t index = anon_write_slot(kva);
+		if(index != BITMAP_ERROR)
+			anon_page->idx = index;
+		else
+			success = false;
+	}
+
+	lock_acquire(&swap_lock);
+	list_remove(&sce.elem);
+	lock_release(&swap_lock);
+	/* A rescued page is resident again; the pool copy is redundant,
+	 * while a disk copy is as good as if it had been read back. */
+	if(sce.rescued)
+		zswap_free(page);
+	else if(!success){
+		page->frame = frame;
+		pml4_set_page(pml4, page->va, kva, page->writable && !page->copy_writable);
+		pml4_set_dirty(pml4, page->va, dirty);
+	}
+	return success || sce.rescued;
+}
+
+/* Prints swap statistics. */
+void
+anon_print_stats (void) {
+	printf("Swap: %lld pages written, %lld read, %lld clean writes avoided, %lld rescued from writeback\n",
+			swap_write_cnt, swap_read_cnt, clean_skip_cnt, rescue_cnt);
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
-	if(page->frame != NULL){
-		list_remove(&page->frame->frame_elem);
-		free(page->frame);
-	}
+	if(page->frame != NULL)
+		vm_free_frame(page->frame);
+	/* Drop the zswap entry before the slot, as anon_release_all() does. */
+	zswap_free(page);
+	anon_release_slot(anon_page);
 }
@@ -5,6 +5,16 @@
 #include "threads/mmu.h"
 #include "threads/malloc.h"
 #include "userprog/syscall.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Most pages written back to a file in one write. */
+#define WRITEBACK_BATCH 16
+
+/* Statistics. */
+static long long writeback_pages;   /* # of dirty pages written back. */
+static long long writeback_runs;    /* # of writes they took. */
 
 static bool lazy_mmap(struct page *page, void *aux);
 
@@ -31,7 +41,13 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	struct segment *seg = (struct segment*)page->uninit.aux;
 	page->operations = &file_ops;
 
+	/* The union is shared with uninit_page: read SEG first. */
 	struct file_page *file_page = &page->file;
+	file_page->file = seg->file;
+	file_page->offset = seg->ofs;
+	file_page->read_bytes = seg->page_read_bytes;
+	file_page->thread = thread_current();
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
@@ -56,19 +72,16 @@ file_backed_swap_in (struct page *page, void *kva) {
 static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+	uint64_t *pml4 = file_page->thread->pml4;
 
-	struct segment *seg = (struct segment*)page->uninit.aux;
-	file_page->offset = seg->ofs;
-	file_page->file = seg->file;
-	file_page->read_bytes = seg->page_read_bytes;
-
-	if (pml4_is_dirty(thread_current()->pml4, page->va)){
+	if (pml4_is_dirty(pml4, page->va)){
 		lock_acquire(&filesys_lock);
-		file_write_at(seg->file, page->va, seg->page_read_bytes, seg->ofs);
+		file_write_at(file_page->file, page->frame->kva, file_page->read_bytes, file_page->offset);
 		lock_release(&filesys_lock);
-		pml4_set_dirty(thread_current()->pml4, page->va, false);
+		pml4_set_dirty(pml4, page->va, false);
 	}
-	pml4_clear_page(thread_current()->pml4, page->va);
+	pml4_clear_page(pml4, page->va);
+	page->frame = NULL;
 	return true;
 }
 
@@ -76,7 +89,8 @@ file_backed_swap_out (struct page *page) {
 static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
-	free(page->frame);
+	if (page->frame != NULL)
+		vm_free_frame(page->frame);
 }
 
 /* Do the mmap */
@@ -110,24 +124,132 @@ do_mmap (void *addr, size_t length, int writable, struct file *file, off_t offse
 	return init_addr;
 }
 
+/* Returns the file PAGE maps, or a null pointer if it is not part of
+ * a file mapping. */
+static struct file *
+mapped_file(struct page *page){
+	if (page == NULL || page_get_type(page) != VM_FILE)
+		return NULL;
+	if (VM_TYPE(page->operations->type) == VM_UNINIT)
+		return ((struct segment *)page->uninit.aux)->file;
+	return page->file.file;
+}
+
+/* Orders file pages by file, then by offset. */
+static int
+file_page_cmp(const void *a_, const void *b_){
+	const struct file_page *a = &(*(struct page *const *)a_)->file;
+	const struct file_page *b = &(*(struct page *const *)b_)->file;
+
+	if (a->file != b->file)
+		return a->file < b->file ? -1 : 1;
+	return a->offset < b->offset ? -1 : a->offset > b->offset;
+}
+
+/* Writes back the dirty file pages among the CNT pages in PAGES, which
+ * are mapped in PML4, and marks them clean.  Pages go out in order of
+ * file and offset, and each run of pages that follow one another in
+ * their file is written with a single file_write_at().  PAGES may hold
+ * other pages too; it is reordered. */
+void
+file_backed_writeback(struct page **pages, size_t cnt, uint64_t *pml4){
+	size_t dirty_cnt = 0, batch = WRITEBACK_BATCH, i, j, k;
+	uint8_t *buf;
+
+	/* Move the dirty file pages to the front. */
+	for (i = 0; i < cnt; i++){
+		struct page *page = pages[i];
+		if (page->frame != NULL && VM_TYPE(page->operations->type) == VM_FILE
+				&& pml4_is_dirty(pml4, page->va)){
+			pages[i] = pages[dirty_cnt];
+			pages[dirty_cnt++] = page;
+		}
+	}
+	if (dirty_cnt == 0)
+		return;
+	qsort(pages, dirty_cnt, sizeof *pages, file_page_cmp);
+
+	buf = dirty_cnt > 1 ? palloc_get_multiple(0, WRITEBACK_BATCH) : NULL;
+	if (buf == NULL)
+		batch = 1;
+
+	for (i = 0; i < dirty_cnt; i = j){
+		struct file_page *first = &pages[i]->file;
+		size_t len = first->read_bytes;
+		const void *src = pages[i]->frame->kva;
+
+		for (j = i + 1; j < dirty_cnt && j - i < batch; j++){
+			struct file_page *prev = &pages[j - 1]->file;
+			struct file_page *next = &pages[j]->file;
+			if (next->file != first->file || prev->read_bytes != PGSIZE
+					|| next->offset != prev->offset + PGSIZE)
+				break;
+			len += next->read_bytes;
+		}
+		if (j - i > 1){
+			for (k = i; k < j; k++)
+				memcpy(buf + (k - i) * PGSIZE, pages[k]->frame->kva, pages[k]->file.read_bytes);
+			src = buf;
+		}
+
+		lock_acquire(&filesys_lock);
+		file_write_at(first->file, src, len, first->offset);
+		lock_release(&filesys_lock);
+		for (k = i; k < j; k++)
+			pml4_set_dirty(pml4, pages[k]->va, false);
+		writeback_runs++;
+		writeback_pages += j - i;
+	}
+	if (buf != NULL)
+		palloc_free_multiple(buf, WRITEBACK_BATCH);
+}
+
+/* Unmaps the file mapping that starts at ADDR.  Its dirty pages are
+ * written back together before the pages are dropped.  A shared memory
+ * mapping is handed to shm_unmap(). */
 void do_munmap(void *addr){
 	struct thread *curr = thread_current();
 	struct page *page = spt_find_page(&curr->spt, addr);
-	if (page == NULL)
-		return; 
-
-	while (page != NULL){
-		struct segment *seg = (struct segment*)page->uninit.aux;
-		if (pml4_is_dirty(curr->pml4, addr)){
-			lock_acquire(&filesys_lock);
-			file_write_at(seg->file, addr, seg->page_read_bytes, seg->ofs);
-			lock_release(&filesys_lock);
-			pml4_set_dirty(curr->pml4, addr, 0);
+	struct file *file = mapped_file(page);
+	struct page **pages;
+	size_t cnt, i;
+
+	if (page != NULL && page_get_type(page) == VM_SHM){
+		shm_unmap(addr);
+		return;
+	}
+	if (file == NULL)
+		return;
+	for (cnt = 1; mapped_file(spt_find_page(&curr->spt, addr + cnt * PGSIZE)) == file; cnt++)
+		continue;
+
+	pages = malloc(cnt * sizeof *pages);
+	for (i = 0; i < cnt; i++){
+		page = spt_find_page(&curr->spt, addr + i * PGSIZE);
+		if (pages != NULL)
+			pages[i] = page;
+		else{
+			file_backed_writeback(&page, 1, curr->pml4);
+			pml4_clear_page(curr->pml4, page->va);
+			spt_remove_page(&curr->spt, page);
 		}
-		pml4_clear_page(curr->pml4, page->va);
-		addr += PGSIZE;
-		page = spt_find_page(&curr->spt, addr);
 	}
+	if (pages == NULL)
+		return;
+
+	file_backed_writeback(pages, cnt, curr->pml4);
+	for (i = 0; i < cnt; i++){
+		pml4_clear_page(curr->pml4, pages[i]->va);
+		spt_remove_page(&curr->spt, pages[i]);
+	}
+	free(pages);
+}
+
+/* Prints file mapping statistics. */
+void
+file_backed_print_stats(void){
+	printf("mmap: %lld dirty pages written back in %lld writes\n",
+			writeback_pages, writeback_runs);
 }
 
 static bool lazy_mmap(struct page *page, void *aux){
@@ -152,5 +274,7 @@ static bool lazy_mmap(struct page *page, void *aux){
 	}
 
 	memset(frame->kva + page_read_bytes, 0, page_zero_bytes);
+	/* file_backed_initializer() copied what is still needed. */
+	free(seg);
 	return true;
 }
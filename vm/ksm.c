@@ -0,0 +1,281 @@
+/* ksm.c: Same-page merging for anonymous memory.
+ *
+ * The ksmd thread walks the frame table a few pages at a time, hashes
+ * the contents of resident anonymous pages and merges pages with equal
+ * contents into a single write-protected frame.  A later write to one of
+ * them is handled as a copy-on-write fault by vm_handle_wp(). */
+
+#include "vm/ksm.h"
+#include <intrinsic.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+
+/* Scan budget.  ksmd wakes up every KSM_SLEEP_TICKS and then looks at
+ * KSM_PAGES_PER_TICK pages for every tick it slept. */
+#define KSM_SLEEP_TICKS 10
+#define KSM_PAGES_PER_TICK 4
+#define KSM_BATCH (KSM_SLEEP_TICKS * KSM_PAGES_PER_TICK)
+
+/* CR0 bit that makes read-only pages read-only in kernel mode too. */
+#define CR0_WP (1ULL << 16)
+
+/* Shared pages, keyed by the hash of their contents. */
+static struct hash ksm_stable;
+static struct lock ksm_lock;
+
+/* Index in frame_table where the next batch starts. */
+static size_t ksm_cursor;
+
+/* Statistics. */
+static long long pages_scanned;  /* # of frames hashed. */
+static long long pages_merged;   /* # of frames freed by merging. */
+static long long pages_shared;   /* # of ksm_pages currently in use. */
+static long long pages_sharing;  /* # of frames currently mapping them. */
+
+static void ksmd (void *aux UNUSED);
+
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_page, elem)->checksum;
+}
+
+static bool
+ksm_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct ksm_page, elem)->checksum
+		< hash_entry (b, struct ksm_page, elem)->checksum;
+}
+
+/* Starts the ksmd thread.  Merging is only safe when the kernel's
+ * own writes into user pages, e.g. read() into a user buffer, fault
+ * on write-protected pages and so go through vm_handle_wp().  Without
+ * CR0.WP they would change the frame of every page sharing it. */
+void
+ksm_init (void) {
+	hash_init (&ksm_stable, ksm_hash, ksm_less, NULL);
+	lock_init (&ksm_lock);
+	if ((rcr0 () & CR0_WP) == 0) {
+		printf ("ksm: kernel writes bypass write protection, not merging\n");
+		return;
+	}
+	thread_create ("ksmd", PRI_MIN, ksmd, NULL);
+}
+
+/* Makes DST, a fresh frame for a copy of SRC's page, share SRC's ksm
+ * page.  Used when fork() duplicates a merged page. */
+void
+ksm_share (struct frame *dst, struct frame *src) {
+	lock_acquire (&ksm_lock);
+	dst->ksm = src->ksm;
+	if (dst->ksm != NULL) {
+		dst->ksm->share_cnt++;
+		pages_sharing++;
+	}
+	lock_release (&ksm_lock);
+}
+
+/* Detaches FRAME from its ksm page, which is freed along with its
+ * physical page when FRAME was the last one mapping it. */
+void
+ksm_unshare (struct frame *frame) {
+	void *kva = ksm_release (frame);
+
+	if (kva != NULL)
+		palloc_free_page (kva);
+}
+
+/* Detaches FRAME from its ksm page.  If FRAME was the last one mapping
+ * it, frees the ksm page and returns its physical page, which now
+ * belongs to the caller; otherwise returns a null pointer. */
+void *
+ksm_release (struct frame *frame) {
+	struct ksm_page *kp = frame->ksm;
+	void *kva = NULL;
+
+	if (kp == NULL)
+		return NULL;
+	lock_acquire (&ksm_lock);
+	frame->ksm = NULL;
+	pages_sharing--;
+	if (--kp->share_cnt == 0) {
+		if (kp->stable)
+			hash_delete (&ksm_stable, &kp->elem);
+		pages_shared--;
+		kva = kp->kva;
+	}
+	lock_release (&ksm_lock);
+
+	if (kva != NULL)
+		free (kp);
+	return kva;
+}
+
+/* Returns true if FRAME holds a resident, mapped anonymous page that ksm
+ * may look at. */
+static bool
+is_mergeable (struct frame *frame) {
+	struct page *page = frame->page;
+
+	if (frame->pinned)
+		return false;
+	if (page == NULL || page->frame != frame
+			|| VM_TYPE (page->operations->type) != VM_ANON)
+		return false;
+	if (page->copy_writable && frame->ksm == NULL)
+		return false;
+	uint64_t *pml4 = page->anon.thread->pml4;
+	return pml4 != NULL && pml4_get_page (pml4, page->va) == frame->kva;
+}
+
+/* Write-protects FRAME's page and points its mapping at KVA. */
+static void
+ksm_remap (struct frame *frame, void *kva) {
+	struct page *page = frame->page;
+
+	if (page->writable)
+		page->copy_writable = true;
+	pml4_set_page (page->anon.thread->pml4, page->va, kva, false);
+	frame->kva = kva;
+}
+
+/* Tries to merge FRAME into the ksm page KP, or into the frame OTHER
+ * when KP is null.  Returns the page FRAME ended up sharing, or a null
+ * pointer if the contents turned out to differ.  Must be called with
+ * frame_lock and ksm_lock held. */
+static struct ksm_page *
+ksm_merge (struct frame *frame, struct ksm_page *kp, struct frame *other,
+		uint64_t checksum) {
+	void *target = kp != NULL ? kp->kva : other->kva;
+	void *old_kva = frame->kva;
+	bool fresh = kp == NULL;
+	enum intr_level old_level;
+
+	/* Pages shared by fork() have no ksm_page to count their users. */
+	if (frame->ksm != NULL || vm_frame_is_shared (frame))
+		return NULL;
+	if (fresh && (other->ksm != NULL || vm_frame_is_shared (other)))
+		return NULL;
+	if (fresh) {
+		kp = malloc (sizeof *kp);
+		if (kp == NULL)
+			return NULL;
+		kp->kva = other->kva;
+		kp->checksum = checksum;
+		kp->share_cnt = 0;
+		kp->stable = false;
+	}
+
+	/* Nobody may write either page between the comparison and the
+	 * switch-over. */
+	old_level = intr_disable ();
+	if (memcmp (old_kva, target, PGSIZE)) {
+		intr_set_level (old_level);
+		if (fresh)
+			free (kp);
+		return NULL;
+	}
+	if (fresh) {
+		ksm_remap (other, target);
+		other->ksm = kp;
+		kp->share_cnt = 1;
+	}
+	ksm_remap (frame, target);
+	frame->ksm = kp;
+	kp->share_cnt++;
+	intr_set_level (old_level);
+
+	if (fresh) {
+		/* On a checksum collision the older page stays findable. */
+		kp->stable = hash_insert (&ksm_stable, &kp->elem) == NULL;
+		pages_shared++;
+		pages_sharing++;
+	}
+	pages_sharing++;
+	pages_merged++;
+
+	palloc_free_page (old_kva);
+	return kp;
+}
+
+/* Returns the ksm page with CHECKSUM, if any.  Must be called with
+ * ksm_lock held. */
+static struct ksm_page *
+ksm_find_stable (uint64_t checksum) {
+	struct ksm_page key;
+	struct hash_elem *e;
+
+	key.checksum = checksum;
+	e = hash_find (&ksm_stable, &key.elem);
+	return e != NULL ? hash_entry (e, struct ksm_page, elem) : NULL;
+}
+
+/* Scans up to KSM_BATCH frames starting at ksm_cursor.  Each page is
+ * matched against the shared pages first and then against the other
+ * pages of the same batch.  ksm_lock is held throughout so that no
+ * shared page goes away while it is being merged into. */
+static void
+ksm_scan (void) {
+	struct frame *seen[KSM_BATCH];
+	uint64_t sums[KSM_BATCH];
+	size_t seen_cnt = 0, idx = 0;
+	struct list_elem *e;
+
+	lock_acquire (&frame_lock);
+	lock_acquire (&ksm_lock);
+	for (e = list_begin (&frame_table); e != list_end (&frame_table)
+			&& idx < ksm_cursor; e = list_next (e))
+		idx++;
+	if (e == list_end (&frame_table)) {
+		e = list_begin (&frame_table);
+		idx = 0;
+	}
+
+	for (; e != list_end (&frame_table) && seen_cnt < KSM_BATCH;
+			e = list_next (e), idx++) {
+		struct frame *frame = list_entry (e, struct frame, frame_elem);
+		struct ksm_page *kp;
+		uint64_t checksum;
+		size_t i;
+
+		if (!is_mergeable (frame) || frame->ksm != NULL)
+			continue;
+		checksum = hash_bytes (frame->kva, PGSIZE);
+		pages_scanned++;
+
+		kp = ksm_find_stable (checksum);
+		if (kp != NULL && ksm_merge (frame, kp, NULL, checksum) != NULL)
+			continue;
+		for (i = 0; i < seen_cnt; i++)
+			if (sums[i] == checksum && seen[i]->ksm == NULL
+					&& ksm_merge (frame, NULL, seen[i], checksum) != NULL)
+				break;
+		if (i == seen_cnt) {
+			seen[seen_cnt] = frame;
+			sums[seen_cnt++] = checksum;
+		}
+	}
+	ksm_cursor = idx;
+	lock_release (&ksm_lock);
+	lock_release (&frame_lock);
+}
+
+/* ksm daemon.  Sleeps and scans, forever, at the lowest priority. */
+static void
+ksmd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (KSM_SLEEP_TICKS);
+		ksm_scan ();
+	}
+}
+
+/* Prints ksm statistics. */
+void
+ksm_print_stats (void) {
+	printf ("KSM: %lld pages scanned, %lld merged, %lld shared, %lld sharing\n",
+			pages_scanned, pages_merged, pages_shared, pages_sharing);
+}
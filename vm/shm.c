@@ -0,0 +1,527 @@
+/* shm.c: Named shared memory segments and futexes.
+ *
+ * A segment is an array of pages, each kept by a struct shm_slot that
+ * holds the page's only frame while it is resident and its swap slot
+ * while it is not.  A process maps segment pages with VM_SHM pages (see
+ * struct shm_page), which sit on their slot's mapping list and never
+ * own a frame: a fault maps the slot's frame directly.  That frame is
+ * on the frame table like any other, owned by the slot's anchor page,
+ * so evicting it unmaps the page from every process that maps it and
+ * writes it to swap once.
+ *
+ * Segments are named like files but live outside the file system.  One
+ * goes away once it has been unlinked and is neither open nor mapped.
+ *
+ * Futexes are keyed by segment and offset for addresses inside a
+ * segment, so that processes mapping it at different addresses meet,
+ * and by process and address everywhere else. */
+
+#include "vm/shm.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "lib/kernel/bitmap.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* One page of a segment. */
+struct shm_slot {
+	struct page anchor;          /* Owner of FRAME on the frame table. */
+	struct frame *frame;         /* Resident copy, or null. */
+	size_t swap_idx;             /* Swap slot, or BITMAP_ERROR. */
+	struct list mappings;        /* shm_page.elem of pages mapping it. */
+};
+
+struct shm_segment {
+	struct list_elem elem;       /* In shm_segments until unlinked. */
+	char name[SHM_NAME_MAX + 1];
+	size_t page_cnt;             /* Size in pages. */
+	struct shm_slot **slots;     /* PAGE_CNT slots, made when first mapped. */
+	int open_cnt;                /* # of open files for the segment. */
+	int map_cnt;                 /* # of process pages mapping it. */
+	bool unlinked;               /* Removed from shm_segments? */
+};
+
+/* Linked segments.  shm_lock also protects every segment, its slots
+ * and their mapping lists. */
+static struct list shm_segments;
+static struct lock shm_lock;
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter {
+	struct list_elem elem;
+	const void *obj;             /* Segment or thread of the key. */
+	uintptr_t ofs;               /* Offset in OBJ of the key. */
+	struct semaphore sema;       /* Upped by futex_wake(). */
+};
+static struct list futex_waiters;
+static struct lock futex_lock;
+
+/* Statistics. */
+static long long swap_out_cnt;   /* # of segment pages swapped out. */
+static long long swap_in_cnt;    /* # of them read back. */
+static long long futex_wait_cnt; /* # of futex_wait() calls that slept. */
+static long long futex_wake_cnt; /* # of threads woken by futex_wake(). */
+
+static bool shm_swap_in (struct page *page, void *kva);
+static bool shm_swap_out (struct page *page);
+static void shm_destroy (struct page *page);
+static const struct page_operations shm_ops = {
+	.swap_in = shm_swap_in,
+	.swap_out = shm_swap_out,
+	.destroy = shm_destroy,
+	.type = VM_SHM,
+};
+
+void
+shm_init (void) {
+	list_init (&shm_segments);
+	lock_init (&shm_lock);
+	list_init (&futex_waiters);
+	lock_init (&futex_lock);
+}
+
+/* Returns the linked segment called NAME, or a null pointer.  Must be
+ * called with shm_lock held. */
+static struct shm_segment *
+shm_find (const char *name) {
+	struct list_elem *e;
+
+	for (e = list_begin (&shm_segments); e != list_end (&shm_segments);
+			e = list_next (e)) {
+		struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+		if (!strcmp (seg->name, name))
+			return seg;
+	}
+	return NULL;
+}
+
+/* Frees SEG if it is unlinked, closed and unmapped.  Must be called
+ * with shm_lock held. */
+static void
+shm_maybe_free (struct shm_segment *seg) {
+	size_t i;
+
+	if (!seg->unlinked || seg->open_cnt > 0 || seg->map_cnt > 0)
+		return;
+	for (i = 0; i < seg->page_cnt; i++) {
+		struct shm_slot *slot = seg->slots[i];
+		if (slot == NULL)
+			continue;
+		if (slot->frame != NULL)
+			vm_free_frame (slot->frame);
+		else if (slot->swap_idx != BITMAP_ERROR)
+			anon_free_slot (slot->swap_idx);
+		free (slot);
+	}
+	free (seg->slots);
+	free (seg);
+}
+
+/* Opens the segment called NAME, creating it with SIZE bytes, rounded
+ * up to whole pages, if there is none.  Opening an existing segment
+ * fails if SIZE is larger than it, and creating one fails if SIZE is
+ * 0.  Returns the segment, which must be closed with
+ * shm_segment_close(), or a null pointer on failure. */
+struct shm_segment *
+shm_segment_open (const char *name, size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	struct shm_segment *seg;
+
+	if (strlen (name) > SHM_NAME_MAX || page_cnt > SHM_MAX_PAGES)
+		return NULL;
+
+	lock_acquire (&shm_lock);
+	seg = shm_find (name);
+	if (seg != NULL) {
+		if (page_cnt <= seg->page_cnt)
+			seg->open_cnt++;
+		else
+			seg = NULL;
+	} else if (page_cnt > 0 && (seg = calloc (1, sizeof *seg)) != NULL) {
+		seg->slots = calloc (page_cnt, sizeof *seg->slots);
+		if (seg->slots != NULL) {
+			strlcpy (seg->name, name, sizeof seg->name);
+			seg->page_cnt = page_cnt;
+			seg->open_cnt = 1;
+			list_push_back (&shm_segments, &seg->elem);
+		} else {
+			free (seg);
+			seg = NULL;
+		}
+	}
+	lock_release (&shm_lock);
+	return seg;
+}
+
+/* Takes another open reference to SEG. */
+void
+shm_segment_reopen (struct shm_segment *seg) {
+	lock_acquire (&shm_lock);
+	seg->open_cnt++;
+	lock_release (&shm_lock);
+}
+
+/* Drops an open reference to SEG. */
+void
+shm_segment_close (struct shm_segment *seg) {
+	lock_acquire (&shm_lock);
+	seg->open_cnt--;
+	shm_maybe_free (seg);
+	lock_release (&shm_lock);
+}
+
+/* Removes the name of the segment called NAME.  The segment lives on
+ * until it is closed and unmapped everywhere, but shm_segment_open()
+ * no longer finds it.  Returns false if there is no such segment. */
+bool
+shm_segment_unlink (const char *name) {
+	struct shm_segment *seg;
+
+	lock_acquire (&shm_lock);
+	seg = shm_find (name);
+	if (seg != NULL) {
+		list_remove (&seg->elem);
+		seg->unlinked = true;
+		shm_maybe_free (seg);
+	}
+	lock_release (&shm_lock);
+	return seg != NULL;
+}
+
+/* Returns the size of SEG in bytes. */
+size_t
+shm_segment_size (struct shm_segment *seg) {
+	return seg->page_cnt * PGSIZE;
+}
+
+/* Returns slot IDX of SEG, making it if needed.  Returns a null pointer
+ * if memory is short.  Must be called with shm_lock held. */
+static struct shm_slot *
+shm_slot_get (struct shm_segment *seg, size_t idx) {
+	struct shm_slot *slot = seg->slots[idx];
+
+	if (slot == NULL && (slot = calloc (1, sizeof *slot)) != NULL) {
+		slot->anchor.operations = &shm_ops;
+		slot->anchor.shm.seg = seg;
+		slot->anchor.shm.idx = idx;
+		slot->swap_idx = BITMAP_ERROR;
+		list_init (&slot->mappings);
+		seg->slots[idx] = slot;
+	}
+	return slot;
+}
+
+/* Adds a page at VA of the current process that maps page IDX of SEG.
+ * Returns false if memory is short.  Must be called with shm_lock
+ * held. */
+static bool
+shm_add_page (void *va, bool writable, struct shm_segment *seg, size_t idx) {
+	struct thread *curr = thread_current ();
+	struct shm_slot *slot = shm_slot_get (seg, idx);
+	struct page *page = slot != NULL ? calloc (1, sizeof *page) : NULL;
+
+	if (page == NULL)
+		return false;
+	page->operations = &shm_ops;
+	page->va = va;
+	page->writable = writable;
+	page->shm.seg = seg;
+	page->shm.idx = idx;
+	page->shm.thread = curr;
+	if (!spt_insert_page (&curr->spt, page)) {
+		free (page);
+		return false;
+	}
+	list_push_back (&slot->mappings, &page->shm.elem);
+	seg->map_cnt++;
+	return true;
+}
+
+/* Removes the CNT pages of the current process from ADDR on, which map
+ * consecutive pages of one segment. */
+static void
+shm_remove_pages (void *addr, size_t cnt) {
+	struct thread *curr = thread_current ();
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		struct page *page = spt_find_page (&curr->spt, addr + i * PGSIZE);
+		pml4_clear_page (curr->pml4, page->va);
+		spt_remove_page (&curr->spt, page);
+	}
+}
+
+/* Maps LENGTH bytes of SEG, starting at OFFSET, at ADDR in the current
+ * process.  OFFSET must be page-aligned, and the range must lie within
+ * SEG and over no existing page.  Pages come in lazily, on the first
+ * access.  Returns ADDR, or a null pointer on failure. */
+void *
+shm_map (void *addr, size_t length, bool writable, struct shm_segment *seg,
+		off_t offset) {
+	struct thread *curr = thread_current ();
+	size_t cnt = DIV_ROUND_UP (length, PGSIZE);
+	size_t first = offset / PGSIZE;
+	size_t i;
+
+	if (offset < 0 || offset % PGSIZE != 0 || cnt == 0
+			|| first >= seg->page_cnt || cnt > seg->page_cnt - first)
+		return NULL;
+	for (i = 0; i < cnt; i++)
+		if (!is_user_vaddr (addr + i * PGSIZE)
+				|| spt_find_page (&curr->spt, addr + i * PGSIZE) != NULL)
+			return NULL;
+
+	lock_acquire (&shm_lock);
+	for (i = 0; i < cnt; i++)
+		if (!shm_add_page (addr + i * PGSIZE, writable, seg, first + i))
+			break;
+	lock_release (&shm_lock);
+
+	if (i < cnt) {
+		shm_remove_pages (addr, i);
+		return NULL;
+	}
+	return addr;
+}
+
+/* Unmaps the segment mapping that starts at ADDR. */
+void
+shm_unmap (void *addr) {
+	struct thread *curr = thread_current ();
+	struct page *page = spt_find_page (&curr->spt, addr);
+	struct page *next;
+	size_t cnt;
+
+	if (page == NULL || page_get_type (page) != VM_SHM)
+		return;
+	for (cnt = 1; ; cnt++) {
+		next = spt_find_page (&curr->spt, addr + cnt * PGSIZE);
+		if (next == NULL || page_get_type (next) != VM_SHM
+				|| next->shm.seg != page->shm.seg
+				|| next->shm.idx != page->shm.idx + cnt)
+			break;
+	}
+	shm_remove_pages (addr, cnt);
+}
+
+/* Maps PAGE, a segment page of the current process, bringing the
+ * segment page into memory first if needed. */
+bool
+shm_claim (struct page *page) {
+	struct shm_slot *slot;
+	struct frame *frame = NULL;
+	bool success;
+
+	for (;;) {
+		lock_acquire (&shm_lock);
+		slot = page->shm.seg->slots[page->shm.idx];
+		if (slot->frame != NULL || frame != NULL)
+			break;
+		/* Getting a frame may evict a segment page, which takes
+		 * shm_lock. */
+		lock_release (&shm_lock);
+		frame = vm_get_frame (false);
+		if (frame == NULL)
+			return false;
+	}
+	if (slot->frame == NULL) {
+		frame->page = &slot->anchor;
+		slot->anchor.frame = frame;
+		slot->frame = frame;
+		swap_in (&slot->anchor, frame->kva);
+		frame = NULL;
+	}
+	slot->anchor.va = page->va;
+	success = pml4_set_page (page->shm.thread->pml4, page->va,
+			slot->frame->kva, page->writable);
+	lock_release (&shm_lock);
+
+	/* Someone else brought the page in meanwhile. */
+	if (frame != NULL)
+		vm_free_frame (frame);
+	return success;
+}
+
+/* Fills KVA with the contents of PAGE, a slot's anchor page: zeros for
+ * a page never used, otherwise the copy in swap, whose slot is then
+ * given back.  Must be called with shm_lock held. */
+static bool
+shm_swap_in (struct page *page, void *kva) {
+	struct shm_slot *slot = page->shm.seg->slots[page->shm.idx];
+
+	if (slot->swap_idx == BITMAP_ERROR) {
+		memset (kva, 0, PGSIZE);
+		return true;
+	}
+	anon_read_slot (slot->swap_idx, kva);
+	anon_free_slot (slot->swap_idx);
+	slot->swap_idx = BITMAP_ERROR;
+	swap_in_cnt++;
+	return true;
+}
+
+/* Evicts PAGE, a slot's anchor page: unmaps it from every process that
+ * maps it and writes it to swap.  The caller reuses the frame. */
+static bool
+shm_swap_out (struct page *page) {
+	struct shm_slot *slot = page->shm.seg->slots[page->shm.idx];
+	struct list_elem *e;
+	size_t idx;
+
+	lock_acquire (&shm_lock);
+	for (e = list_begin (&slot->mappings); e != list_end (&slot->mappings);
+			e = list_next (e)) {
+		struct page *m = list_entry (e, struct page, shm.elem);
+		if (m->shm.thread->pml4 != NULL)
+			pml4_clear_page (m->shm.thread->pml4, m->va);
+	}
+	idx = anon_write_slot (page->frame->kva);
+	if (idx == BITMAP_ERROR) {
+		lock_release (&shm_lock);
+		return false;
+	}
+	slot->swap_idx = idx;
+	slot->frame = NULL;
+	page->frame = NULL;
+	swap_out_cnt++;
+	lock_release (&shm_lock);
+	return true;
+}
+
+/* Drops PAGE, a segment page of a process, from its mapping list.  The
+ * caller unmaps it and frees it. */
+static void
+shm_destroy (struct page *page) {
+	struct shm_segment *seg = page->shm.seg;
+
+	lock_acquire (&shm_lock);
+	list_remove (&page->shm.elem);
+	seg->map_cnt--;
+	shm_maybe_free (seg);
+	lock_release (&shm_lock);
+}
+
+/* Makes the current process, a fork() child, map the same segment page
+ * as PARENT does. */
+bool
+shm_copy_page (struct page *parent) {
+	bool success;
+
+	lock_acquire (&shm_lock);
+	success = shm_add_page (parent->va, parent->writable, parent->shm.seg,
+			parent->shm.idx);
+	lock_release (&shm_lock);
+	return success;
+}
+
+/* Drops every segment page in SPT_HASH from its mapping list, taking
+ * shm_lock only once.  Used when an address space is torn down; the
+ * pages are then freed without being destroyed. */
+void
+shm_release_all (struct hash *spt_hash) {
+	struct hash_iterator i;
+
+	lock_acquire (&shm_lock);
+	hash_first (&i, spt_hash);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, hash_elem);
+		if (VM_TYPE (page->operations->type) != VM_SHM)
+			continue;
+		list_remove (&page->shm.elem);
+		page->shm.seg->map_cnt--;
+		shm_maybe_free (page->shm.seg);
+	}
+	lock_release (&shm_lock);
+}
+
+/* Computes the key of the futex at ADDR in the current process. */
+static void
+futex_key (int *addr, const void **obj, uintptr_t *ofs) {
+	struct thread *curr = thread_current ();
+	struct page *page = spt_find_page (&curr->spt, addr);
+
+	if (page != NULL && page_get_type (page) == VM_SHM) {
+		*obj = page->shm.seg;
+		*ofs = page->shm.idx * PGSIZE + pg_ofs (addr);
+	} else {
+		*obj = curr;
+		*ofs = (uintptr_t) addr;
+	}
+}
+
+/* Returns true if ADDR is a properly aligned int of the current
+ * process. */
+static bool
+futex_valid (int *addr) {
+	return addr != NULL && is_user_vaddr (addr)
+		&& (uintptr_t) addr % sizeof *addr == 0
+		&& spt_find_page (&thread_current ()->spt, addr) != NULL;
+}
+
+/* Sleeps until futex_wake() is called on ADDR, provided that *ADDR
+ * still equals VAL.  Checking and going to sleep are atomic with
+ * respect to futex_wake().  Returns 0 after waking up, or -1 at once
+ * if *ADDR differs from VAL or ADDR is bad. */
+int
+futex_wait (int *addr, int val) {
+	struct futex_waiter w;
+
+	if (!futex_valid (addr))
+		return -1;
+	lock_acquire (&futex_lock);
+	if (*(volatile int *) addr != val) {
+		lock_release (&futex_lock);
+		return -1;
+	}
+	futex_key (addr, &w.obj, &w.ofs);
+	sema_init (&w.sema, 0);
+	list_push_back (&futex_waiters, &w.elem);
+	futex_wait_cnt++;
+	lock_release (&futex_lock);
+
+	sema_down (&w.sema);
+	return 0;
+}
+
+/* Wakes up at most CNT threads sleeping on ADDR, oldest first.
+ * Returns the number woken, or -1 if ADDR is bad. */
+int
+futex_wake (int *addr, int cnt) {
+	const void *obj;
+	uintptr_t ofs;
+	struct list_elem *e;
+	int woken = 0;
+
+	if (!futex_valid (addr))
+		return -1;
+	lock_acquire (&futex_lock);
+	futex_key (addr, &obj, &ofs);
+	for (e = list_begin (&futex_waiters);
+			e != list_end (&futex_waiters) && woken < cnt; ) {
+		struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+		if (w->obj == obj && w->ofs == ofs) {
+			e = list_remove (e);
+			sema_up (&w->sema);
+			woken++;
+		} else
+			e = list_next (e);
+	}
+	futex_wake_cnt += woken;
+	lock_release (&futex_lock);
+	return woken;
+}
+
+/* Prints shared memory statistics. */
+void
+shm_print_stats (void) {
+	printf ("shm: %lld pages swapped out, %lld swapped in\n",
+			swap_out_cnt, swap_in_cnt);
+	printf ("futex: %lld waits, %lld wakeups\n",
+			futex_wait_cnt, futex_wake_cnt);
+}
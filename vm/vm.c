@@ -1,12 +1,16 @@
 /* vm.c: Generic interface for virtual memory objects. */
 #include "threads/malloc.h"
 #include "vm/vm.h"
+#include "lib/kernel/bitmap.h"
 #include "vm/inspect.h"
 #include "threads/vaddr.h"
 #include "include/userprog/process.h"
 #include "threads/mmu.h"
 #include "threads/thread.h"
 #include "vm/file.h"
+#include "vm/ksm.h"
+#include "vm/zswap.h"
+#include <stdio.h>
 #include <string.h>
 static unsigned hash_func(const struct hash_elem *p_elem, void *aux UNUSED);
 static bool less_func(const struct hash_elem *a, const struct hash_elem *b, void *aux);
@@ -15,6 +19,56 @@ bool install_page(void *upage, void *kpage, bool writable);
 static void vm_stack_growth(void *addr UNUSED);
 void destroy_frame_table(void);
 
+/* -fa: Map neighbouring pages on file-backed faults?  Off by default,
+ * since it gives up strict lazy loading. */
+bool vm_fault_around_enabled;
+
+/* Fault-around: pages in the aligned window of this many pages around a
+ * fault on an executable segment are loaded along with the faulting page. */
+#define FAULT_AROUND_PAGES 8
+
+/* Bounds of the adaptive readahead window for mmap'd files, in pages. */
+#define RA_MIN_PAGES 2
+#define RA_MAX_PAGES 32
+
+/* Statistics. */
+static long long fault_cnt;         /* # of faults handled. */
+static long long fault_around_cnt;  /* # of pages mapped by fault-around. */
+static long long readahead_cnt;     /* # of pages mapped by mmap readahead. */
+static long long zero_map_cnt;      /* # of read faults served by zero_page. */
+static long long prezeroed_cnt;     /* # of frames taken from zero_pool. */
+
+/* A single all-zero frame, mapped read-only wherever untouched anonymous
+ * memory is read.  The first write gets the page a frame of its own. */
+static void *zero_page;
+
+/* Frames zeroed ahead of time by the zerod thread, so that fresh
+ * anonymous pages need not be cleared on the fault path. */
+#define ZERO_POOL_SIZE 32
+static void *zero_pool[ZERO_POOL_SIZE];
+static size_t zero_pool_cnt;
+static bool zero_pool_refilling;      /* Has zerod been woken up? */
+static struct lock zero_pool_lock;
+static struct semaphore zero_pool_low; /* Upped to wake up zerod. */
+
+static void vm_zerod(void *aux UNUSED);
+
+/* -reap: Free the memory of exited processes in a reaper thread? */
+bool vm_reaper_enabled;
+
+/* Address space of an exited process, waiting for reaperd. */
+struct vm_reap {
+	struct list_elem elem;
+	struct hash spt_hash;       /* Its pages, with detached frames. */
+};
+static struct list reap_list;
+static struct lock reap_lock;
+static struct semaphore reap_sema;  /* Upped for each queued vm_reap. */
+static long long teardown_cnt;      /* # of address spaces torn down. */
+static long long reaped_cnt;        /* # of them freed by reaperd. */
+
+static void vm_reaperd(void *aux UNUSED);
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void vm_init(void){
@@ -28,6 +82,20 @@ void vm_init(void){
 	/* TODO: Your code goes here. */
 	list_init(&frame_table);
 	lock_init(&frame_lock);
+
+	zero_page = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	lock_init(&zero_pool_lock);
+	sema_init(&zero_pool_low, 1);
+	zero_pool_refilling = true;
+	thread_create("zerod", PRI_MIN, vm_zerod, NULL);
+	ksm_init();
+	shm_init();
+
+	list_init(&reap_list);
+	lock_init(&reap_lock);
+	sema_init(&reap_sema, 0);
+	if (vm_reaper_enabled)
+		thread_create("reaperd", PRI_DEFAULT, vm_reaperd, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -47,7 +115,11 @@ page_get_type(struct page *page){
 /* Helpers */
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
+static bool vm_map_frame(struct page *page, struct frame *frame);
 static struct frame *vm_evict_frame(void);
+static void vm_fault_around(void *va, struct file *file, bool mmap);
+static bool vm_frame_unshare(struct frame *frame);
+static bool vm_evict_shared(struct frame *victim, bool *freed);
 
 bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writable, vm_initializer *init, void *aux){
 	ASSERT(VM_TYPE(type) != VM_UNINIT)
@@ -99,30 +171,80 @@ bool spt_insert_page(struct supplemental_page_table *spt UNUSED, struct page *pa
 }
 
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page){
+	hash_delete(&spt->spt_hash, &page->hash_elem);
 	vm_dealloc_page(page);
 }
 
-// /* Get the struct frame, that will be evicted. */
+/* Returns true if FRAME may be evicted.  A page shared by fork() or
+ * merged by ksm may only go out if all the frames mapping it may.
+ * Must be called with frame_lock held. */
+static bool
+vm_frame_evictable(const struct frame *frame){
+	struct list_elem *e;
+
+	if (frame->pinned || frame->page == NULL)
+		return false;
+	if (frame->ksm == NULL && !vm_frame_is_shared(frame))
+		return true;
+	for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e)){
+		struct frame *f = list_entry(e, struct frame, frame_elem);
+		if (f->kva == frame->kva && (f->pinned || f->page == NULL))
+			return false;
+	}
+	return true;
+}
+
+/* Picks the frame to evict, leaving it on the frame table.  Must be
+ * called with frame_lock held. */
 static struct frame *
-vm_get_victim(void){
-	/* TODO: The policy for eviction is up to you. */
-	struct frame *victim = NULL;
+vm_pick_victim(void){
 	struct list_elem* elem;
-	lock_acquire(&frame_lock);
 	for (elem = list_begin(&frame_table); elem != list_end(&frame_table); elem = list_next(elem)) {		
     	struct frame *curr_frame = list_entry(elem, struct frame, frame_elem);
+		if (!vm_frame_evictable(curr_frame))
+			continue;
 
-    	if (!pml4_is_accessed(thread_current()->pml4, curr_frame->page->va)) {
-			victim = curr_frame;
-			list_remove(elem);
-        	break;
-    	}
+    	if (!pml4_is_accessed(thread_current()->pml4, curr_frame->page->va))
+			return curr_frame;
 		pml4_set_accessed(thread_current()->pml4, curr_frame->page->va, 0);
     }
 
-	if(victim == NULL){
-		elem = list_pop_front(&frame_table);
-		victim = list_entry(elem, struct frame, frame_elem);
+	for (elem = list_begin(&frame_table); elem != list_end(&frame_table); elem = list_next(elem)){
+		struct frame *curr_frame = list_entry(elem, struct frame, frame_elem);
+		if (vm_frame_evictable(curr_frame))
+			return curr_frame;
+	}
+	return NULL;
+}
+
+// /* Get the struct frame, that will be evicted. */
+/* Takes the frame to evict off the frame table.  A frame that shares
+ * its physical page with other frames is evicted here, along with
+ * them, and is returned with a null page. */
+static struct frame *
+vm_get_victim(void){
+	/* TODO: The policy for eviction is up to you. */
+	struct frame *victim;
+	bool freed;
+
+	lock_acquire(&frame_lock);
+	for (;;){
+		victim = vm_pick_victim();
+		if (victim == NULL || (victim->ksm == NULL && !vm_frame_is_shared(victim))){
+			if (victim != NULL)
+				list_remove(&victim->frame_elem);
+			break;
+		}
+		if (!vm_evict_shared(victim, &freed)){
+			victim = NULL;
+			break;
+		}
+		if (freed)
+			break;
+		/* An exited process not yet reaped still holds the merged
+		 * page; its sharers are gone from the frame table, so look
+		 * again. */
+		free(victim);
 	}
 	lock_release(&frame_lock);
 	return victim;
@@ -136,34 +258,282 @@ vm_evict_frame(void){
 	if(victim == NULL)
 		return NULL;
 	/* TODO: swap out the victim and return the evicted frame. */
-	swap_out(victim->page);
+	if (victim->page != NULL)
+		swap_out(victim->page);
 	victim->page = NULL;
-	memset(victim->kva, 0, PGSIZE);
 	return victim;
 }
 
+/* Evicts VICTIM and every other frame that maps its physical page, as
+ * the frames of a parent and child do after fork() and the frames of
+ * pages merged by ksm.  All their
+ * mappings are removed first, so that nobody writes the page while it
+ * goes out, and then it is written to swap once, for all of their
+ * pages to share the slot.  Faults on those pages wait for frame_lock
+ * and so find the slot in place.  On success the sharers are off the
+ * frame table and freed, except VICTIM, and *FREED tells whether
+ * VICTIM's kva may be reused.  Returns false, leaving everything
+ * mapped, if the swap disk is full.  Must be called with frame_lock
+ * held. */
+static bool
+vm_evict_shared(struct frame *victim, bool *freed){
+	void *kva = victim->kva;
+	struct list_elem *e, *next;
+	size_t idx;
+
+	/* Without ksm the last frame off the table owns the page. */
+	*freed = victim->ksm == NULL;
+
+	for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e)){
+		struct frame *f = list_entry(e, struct frame, frame_elem);
+		if (f->kva == kva){
+			ASSERT(VM_TYPE(f->page->operations->type) == VM_ANON);
+			pml4_clear_page(f->page->anon.thread->pml4, f->page->va);
+		}
+	}
+
+	idx = anon_write_slot(kva);
+	for (e = list_begin(&frame_table); e != list_end(&frame_table); e = next){
+		struct frame *f = list_entry(e, struct frame, frame_elem);
+		struct page *page = f->page;
+		uint64_t *pml4;
+
+		next = list_next(e);
+		if (f->kva != kva)
+			continue;
+		pml4 = page->anon.thread->pml4;
+		if (idx == BITMAP_ERROR){
+			pml4_set_page(pml4, page->va, kva, page->writable && !page->copy_writable);
+			pml4_set_dirty(pml4, page->va, true);
+			continue;
+		}
+		page->frame = NULL;
+		page->copy_writable = false;
+		anon_share_slot(page, idx);
+		list_remove(e);
+		vm_frame_unshare(f);
+		if (f->ksm != NULL && ksm_release(f) != NULL)
+			*freed = true;
+		if (f != victim)
+			free(f);
+	}
+	if (idx == BITMAP_ERROR)
+		return false;
+	anon_free_slot(idx);
+
+	victim->page = NULL;
+	return true;
+}
+
+/* Takes a frame out of zero_pool, waking up zerod when the pool runs
+ * low.  Returns a null pointer if the pool is empty. */
+static void *
+zero_pool_get(void){
+	void *kva = NULL;
+	bool wake;
+
+	lock_acquire(&zero_pool_lock);
+	if (zero_pool_cnt > 0)
+		kva = zero_pool[--zero_pool_cnt];
+	wake = zero_pool_cnt < ZERO_POOL_SIZE / 2 && !zero_pool_refilling;
+	if (wake)
+		zero_pool_refilling = true;
+	lock_release(&zero_pool_lock);
+
+	if (wake)
+		sema_up(&zero_pool_low);
+	return kva;
+}
+
+/* Zeroing thread.  Runs at PRI_MIN, so it only gets the CPU when
+ * nothing else wants it, and fills zero_pool with cleared frames
+ * until the pool is full or the user pool is exhausted. */
+static void
+vm_zerod(void *aux UNUSED){
+	for (;;){
+		sema_down(&zero_pool_low);
+		for (;;){
+			void *kva = palloc_get_page(PAL_USER);
+			if (kva == NULL)
+				break;
+			memset(kva, 0, PGSIZE);
+
+			lock_acquire(&zero_pool_lock);
+			if (zero_pool_cnt < ZERO_POOL_SIZE){
+				zero_pool[zero_pool_cnt++] = kva;
+				kva = NULL;
+			}
+			lock_release(&zero_pool_lock);
+
+			if (kva != NULL){
+				palloc_free_page(kva);
+				break;
+			}
+		}
+		lock_acquire(&zero_pool_lock);
+		zero_pool_refilling = false;
+		lock_release(&zero_pool_lock);
+	}
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it. That is, if the user pool memory is full, this function
+ * evicts the frame to get the available memory space, and returns a null
+ * pointer only if no frame can be evicted.
+ * If ZERO is true the frame is returned cleared, preferably straight from
+ * zero_pool; otherwise its contents are undefined. */
+struct frame *
+vm_get_frame(bool zero){
+	struct frame *frame;
+	void *kva = zero ? zero_pool_get() : NULL;
+
+	if (kva != NULL)
+		prezeroed_cnt++;
+	else{
+		kva = palloc_get_page(PAL_USER | (zero ? PAL_ZERO : 0));
+		/* Rather than evicting, eat into the pool of cleared frames. */
+		if (kva == NULL && !zero)
+			kva = zero_pool_get();
+	}
+
+	if (kva == NULL){
+		frame = vm_evict_frame();
+		if (frame == NULL)
+			return NULL;
+		ASSERT(frame->page == NULL);
+		if (zero)
+			memset(frame->kva, 0, PGSIZE);
+	}else{
+		frame = (struct frame *)malloc(sizeof(struct frame));
+		if (frame == NULL){
+			palloc_free_page(kva);
+			return NULL;
+		}
+		frame->kva = kva;
+		frame->page = NULL;
+	}
+	frame->ksm = NULL;
+	frame->share_cnt = NULL;
+	frame->pinned = false;
+	lock_acquire(&frame_lock);
+	list_push_back(&frame_table, &frame->frame_elem);
+	lock_release(&frame_lock);
+	return frame;
+}
+
+/* Like vm_get_frame(), but never evicts: returns a null pointer when the
+ * user pool is exhausted.  Used for pages that are nice to have but not
+ * worth an eviction, such as fault-around neighbours. */
 static struct frame *
-vm_get_frame(void){
+vm_get_frame_noevict(void){
+	void *kva = palloc_get_page(PAL_USER);
+	if (kva == NULL)
+		return NULL;
+
 	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
-	// 반환받은 주소를 frame 구조체에 할당
-	frame->kva = palloc_get_page(PAL_USER);
-	if (frame->kva == NULL){
-		frame = vm_evict_frame();
+	if (frame == NULL){
+		palloc_free_page(kva);
+		return NULL;
 	}
-	/* TODO: Fill this function. */
+	frame->kva = kva;
 	frame->page = NULL;
+	frame->ksm = NULL;
+	frame->share_cnt = NULL;
+	frame->pinned = false;
+	lock_acquire(&frame_lock);
 	list_push_back(&frame_table, &frame->frame_elem);
-
-	ASSERT(frame != NULL);
-	ASSERT(frame->page == NULL);
+	lock_release(&frame_lock);
 	return frame;
 }
 
-/* Growing the stack. */
+/* Returns true if PAGE is anonymous memory that has never been touched,
+ * so that it still reads as all zeros: a fresh VM_ANON page or a bss
+ * page of an executable. */
+static bool
+is_untouched_anon(struct page *page){
+	if (VM_TYPE(page->operations->type) != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON)
+		return false;
+	if (page->uninit.init == NULL)
+		return true;
+	return page->uninit.init == lazy_load_segment
+		&& ((struct segment *)page->uninit.aux)->page_read_bytes == 0;
+}
+
+/* Returns the file behind PAGE if PAGE is a file-backed page that has not
+ * been loaded yet, that is, an executable segment or an mmap'd page that
+ * is still uninit.  Otherwise returns a null pointer. */
+static struct file *
+lazy_file_of(struct page *page){
+	if (VM_TYPE(page->operations->type) != VM_UNINIT || page->uninit.init == NULL)
+		return NULL;
+	if (VM_TYPE(page->uninit.type) != VM_FILE && page->uninit.init != lazy_load_segment)
+		return NULL;
+	return ((struct segment *)page->uninit.aux)->file;
+}
+
+/* Maps the neighbours of the just-faulted page VA that belong to the same
+ * FILE, as long as frames are available without eviction.
+ *
+ * For executables (MMAP false) this is plain fault-around over an aligned
+ * window of FAULT_AROUND_PAGES.  For mmap'd files the window starts after
+ * VA and adapts to the access pattern: it doubles on every fault that
+ * lands where the previous window ended and halves otherwise. */
+static void
+vm_fault_around(void *va, struct file *file, bool mmap){
+	struct thread *curr = thread_current();
+	void *start, *end, *addr;
+
+	if (mmap){
+		if (curr->ra_file != file)
+			curr->ra_pages = RA_MIN_PAGES;
+		else if (va == curr->ra_next)
+			curr->ra_pages = curr->ra_pages * 2 < RA_MAX_PAGES ? curr->ra_pages * 2 : RA_MAX_PAGES;
+		else
+			curr->ra_pages = curr->ra_pages / 2 > RA_MIN_PAGES ? curr->ra_pages / 2 : RA_MIN_PAGES;
+		curr->ra_file = file;
+		start = va + PGSIZE;
+		end = start + curr->ra_pages * PGSIZE;
+	}else{
+		start = (void *)((uint64_t)va & ~((uint64_t)FAULT_AROUND_PAGES * PGSIZE - 1));
+		end = start + FAULT_AROUND_PAGES * PGSIZE;
+	}
+
+	for (addr = start; addr < end && is_user_vaddr(addr); addr += PGSIZE){
+		if (addr == va)
+			continue;
+		struct page *page = spt_find_page(&curr->spt, addr);
+		if (page == NULL || page->frame != NULL || pml4_get_page(curr->pml4, addr) != NULL){
+			/* A hole or a resident page ends the mapping's readahead run,
+			 * but fault-around just skips over it. */
+			if (mmap && page == NULL)
+				break;
+			continue;
+		}
+		if (lazy_file_of(page) != file){
+			if (mmap)
+				break;
+			continue;
+		}
+
+		struct frame *frame = vm_get_frame_noevict();
+		if (frame == NULL)
+			break;
+		if (!vm_map_frame(page, frame)){
+			pml4_clear_page(curr->pml4, addr);
+			vm_free_frame(frame);
+			break;
+		}
+		if (mmap)
+			readahead_cnt++;
+		else
+			fault_around_cnt++;
+	}
+	if (mmap)
+		curr->ra_next = addr;
+}
+
+/* Growing the stack.  The new pages are only registered; each one gets
+ * memory when it is first touched, like any other anonymous page. */
 /*
 pg_round_down은 인자로 전달된 가상 주소를 페이지의 시작주소로 내림차순으로 반올림해서 반환(=새로운 페이지의 시작주소로 삼는다는 뜻)하는 함수임.
 (스택은 아래로 자라기 때문에 주소를 내려줘야함.)
@@ -176,20 +546,68 @@ vm_stack_growth(void *addr UNUSED){
 	addr = pg_round_down(addr);
 	while(addr < curr->stack_bottom){
 		vm_alloc_page_with_initializer(VM_ANON, addr, true, NULL, NULL);
-		vm_claim_page(addr);
 		addr += PGSIZE;
 	}
 }
 
-/* Handle the fault on write_protected page */
+/* Handle the fault on write_protected page.  frame_lock is held
+ * throughout, so that the page is not evicted from under the copy. */
 static bool
 vm_handle_wp(struct page *page UNUSED){
-	void *parent_kva = page->frame->kva;
-	page->frame->kva = palloc_get_page(PAL_USER);
+	void *kva = palloc_get_page(PAL_USER);
+	struct frame *frame;
+	void *old_kva;
+	bool shared;
+
+	if (kva == NULL){
+		/* Make room for the copy.  This may evict PAGE itself. */
+		struct frame *spare = vm_evict_frame();
+		if (spare != NULL){
+			kva = spare->kva;
+			free(spare);
+		}
+	}
+
+	lock_acquire(&frame_lock);
+	frame = page->frame;
+	if (frame == NULL){
+		/* Evicted meanwhile, and private once it comes back. */
+		lock_release(&frame_lock);
+		if (kva != NULL)
+			palloc_free_page(kva);
+		return vm_do_claim_page(page);
+	}
 
-	memcpy(page->frame->kva, parent_kva, PGSIZE);
-	if (!pml4_set_page(thread_current()->pml4, page->va, page->frame->kva, page->copy_writable))
-		palloc_free_page(page->frame->kva);
+	/* The last user of a page shared by fork() may just write to it. */
+	if (frame->ksm == NULL && !vm_frame_is_shared(frame)){
+		vm_frame_unshare(frame);
+		page->copy_writable = false;
+		lock_release(&frame_lock);
+		if (kva != NULL)
+			palloc_free_page(kva);
+		return pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
+	}
+
+	if (kva == NULL){
+		lock_release(&frame_lock);
+		return false;
+	}
+	old_kva = frame->kva;
+	memcpy(kva, old_kva, PGSIZE);
+	if (!pml4_set_page(thread_current()->pml4, page->va, kva, page->writable)){
+		lock_release(&frame_lock);
+		palloc_free_page(kva);
+		return false;
+	}
+	frame->kva = kva;
+	page->copy_writable = false;
+	shared = vm_frame_unshare(frame);
+	lock_release(&frame_lock);
+	/* The frame has its own copy now; drop its share of a merged page. */
+	if (frame->ksm != NULL)
+		ksm_unshare(frame);
+	else if (!shared)
+		palloc_free_page(old_kva);
 	return true;
 }
 
@@ -201,23 +619,48 @@ bool vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED, bool u
 	if(is_kernel_vaddr(addr) || !addr) 
 		return false;
 
+	fault_cnt++;
 	page = spt_find_page(spt, addr);
 	if(page == NULL){
 		void *rsp = !user ? thread_current()->tf.rsp : f->rsp;
 		if (rsp - (1 << 3) <= addr && addr <= thread_current()->stack_bottom){
 			vm_stack_growth(addr);
 			thread_current()->stack_bottom = pg_round_down(addr);
-			return true;
-		}		
-	}else{
-		if(write && !page->writable)
+			page = spt_find_page(spt, addr);
+		}
+		if(page == NULL)
 			return false;
-		if(write && page->copy_writable)
-			return vm_handle_wp(page);
-		vm_do_claim_page(page);
-		return true;
 	}
-	return false;
+
+	if(write && !page->writable)
+		return false;
+	if(page_get_type(page) == VM_SHM)
+		return shm_claim(page);
+	if(page->frame != NULL){
+		/* Wait out the eviction of a shared frame, which unmaps all of
+		 * its pages before it writes them out. */
+		lock_acquire(&frame_lock);
+		lock_release(&frame_lock);
+	}
+	if(write && page->copy_writable && page->frame != NULL)
+		return vm_handle_wp(page);
+	if(page->frame != NULL)
+		return pml4_get_page(thread_current()->pml4, page->va) != NULL;
+
+	if(page->frame == NULL && pml4_get_page(thread_current()->pml4, page->va) == zero_page){
+		/* First write to a page that has been reading zero_page. */
+		pml4_clear_page(thread_current()->pml4, page->va);
+	}else if(!write && is_untouched_anon(page)){
+		zero_map_cnt++;
+		return install_page(page->va, zero_page, false);
+	}
+
+	struct file *file = lazy_file_of(page);
+	bool mmap = file != NULL && VM_TYPE(page->uninit.type) == VM_FILE;
+	vm_do_claim_page(page);
+	if (file != NULL && vm_fault_around_enabled)
+		vm_fault_around(page->va, file, mmap);
+	return true;
 }
 
 /* Free the page.
@@ -242,9 +685,19 @@ bool vm_claim_page(void *va UNUSED){
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page(struct page *page){
-	struct frame *frame = vm_get_frame();
+	/* Only fresh anonymous pages depend on the frame being cleared;
+	 * everything else is overwritten by swap_in. */
+	bool zero = VM_TYPE(page->operations->type) == VM_UNINIT
+		&& VM_TYPE(page->uninit.type) == VM_ANON && page->uninit.init == NULL;
+	struct frame *frame = vm_get_frame(zero);
 	if(frame == NULL)
 		return false;
+	return vm_map_frame(page, frame);
+}
+
+/* Link PAGE with FRAME, map it and bring its contents in. */
+static bool
+vm_map_frame(struct page *page, struct frame *frame){
 	/* Set links */
 	frame->page = page;
 	page->frame = frame;
@@ -259,6 +712,27 @@ vm_do_claim_page(struct page *page){
 	return false;
 }
 
+/* Allocates a zeroed, writable anonymous page at VA in the current
+ * process and pins its frame: it is never evicted, merged by ksm or
+ * shared with a fork() child, so the kernel may keep using the returned
+ * kva until the page is destroyed with the address space.  Returns a
+ * null pointer on failure. */
+void *vm_pin_page(void *va){
+	struct page *page;
+	struct frame *frame;
+
+	if(!vm_alloc_page(VM_ANON, va, true))
+		return NULL;
+	page = spt_find_page(&thread_current()->spt, va);
+	frame = vm_get_frame(true);
+	if(frame == NULL)
+		return NULL;
+	frame->pinned = true;
+	if(!vm_map_frame(page, frame))
+		return NULL;
+	return frame->kva;
+}
+
 /* Initialize new supplemental page table */
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED){
 	hash_init(&spt->spt_hash, hash_func, less_func, NULL);
@@ -283,12 +757,20 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
 	while (hash_next(&i)){
 		struct page *parent_page = hash_entry(hash_cur(&i), struct page, hash_elem);
 		struct page *copy_page = NULL;
+		/* Pinned pages are the kernel's view of the parent; the child
+		 * does not get them. */
+		if(parent_page->frame != NULL && parent_page->frame->pinned)
+			continue;
 		switch(VM_TYPE(parent_page->operations->type)){
 			case VM_UNINIT:
-				if(VM_TYPE(parent_page->uninit.type == VM_ANON)){
-					struct segment *seg = (struct segment*)malloc(sizeof(struct segment));
-					memcpy(seg, parent_page->uninit.aux, sizeof(struct segment));
-					seg->file = file_duplicate(seg->file);
+				if(VM_TYPE(parent_page->uninit.type) == VM_ANON){
+					struct segment *seg = NULL;
+					/* Stack pages that were never touched carry no segment. */
+					if(parent_page->uninit.aux != NULL){
+						seg = (struct segment*)malloc(sizeof(struct segment));
+						memcpy(seg, parent_page->uninit.aux, sizeof(struct segment));
+						seg->file = file_duplicate(seg->file);
+					}
 					if(!vm_alloc_page_with_initializer(parent_page->uninit.type, parent_page->va, parent_page->writable, parent_page->uninit.init, seg))
 						free(seg);
 				}
@@ -304,6 +786,20 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
 				copy_page->frame = copy_frame;
 				copy_frame->page = copy_page;
 				copy_frame->kva = parent_page->frame->kva;
+				copy_frame->ksm = NULL;
+				copy_frame->pinned = false;
+				if(parent_page->frame->share_cnt == NULL){
+					parent_page->frame->share_cnt = malloc(sizeof(int));
+					if(parent_page->frame->share_cnt == NULL){
+						free(copy_frame);
+						copy_page->frame = NULL;
+						return false;
+					}
+					*parent_page->frame->share_cnt = 1;
+				}
+				copy_frame->share_cnt = parent_page->frame->share_cnt;
+				(*copy_frame->share_cnt)++;
+				ksm_share(copy_frame, parent_page->frame);
 				
 				struct thread *curr = thread_current();
 				lock_acquire(&frame_lock);
@@ -316,6 +812,10 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
 				}
 				swap_in(copy_page, copy_frame->kva);
 				break;
+			case VM_SHM:
+				if(!shm_copy_page(parent_page))
+					return false;
+				break;
 			default:
 				break;
 		}
@@ -323,21 +823,136 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
 	return true;
 }
 
+/* Writes back every dirty file page in SPT_HASH, sorted so that
+ * neighbouring pages of a file go out in one write. */
+static void
+vm_writeback_all(struct hash *spt_hash, uint64_t *pml4){
+	struct hash_iterator i;
+	struct page **pages;
+	size_t cnt = 0;
+
+	hash_first(&i, spt_hash);
+	while(hash_next(&i)){
+		struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+		if(page->frame != NULL && VM_TYPE(page->operations->type) == VM_FILE)
+			cnt++;
+	}
+	if(cnt == 0)
+		return;
+
+	pages = malloc(cnt * sizeof *pages);
+	cnt = 0;
+	hash_first(&i, spt_hash);
+	while(hash_next(&i)){
+		struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+		if(page->frame == NULL || VM_TYPE(page->operations->type) != VM_FILE)
+			continue;
+		if(pages != NULL)
+			pages[cnt++] = page;
+		else
+			file_backed_writeback(&page, 1, pml4);
+	}
+	if(pages != NULL){
+		file_backed_writeback(pages, cnt, pml4);
+		free(pages);
+	}
+}
+
+/* Takes the frames of all pages in SPT_HASH off the frame table with a
+ * single acquisition of frame_lock.  A frame whose physical page is
+ * still used by another process is left with a null kva, so that
+ * vm_reap() does not free the page. */
+static void
+vm_detach_frames(struct hash *spt_hash){
+	struct hash_iterator i;
+
+	lock_acquire(&frame_lock);
+	hash_first(&i, spt_hash);
+	while(hash_next(&i)){
+		struct frame *frame = hash_entry(hash_cur(&i), struct page, hash_elem)->frame;
+		if(frame == NULL)
+			continue;
+		list_remove(&frame->frame_elem);
+		if(vm_frame_unshare(frame) && frame->ksm == NULL)
+			frame->kva = NULL;
+	}
+	lock_release(&frame_lock);
+}
+
+/* Frees the frames and pages of SPT_HASH, whose frames have been
+ * detached, and then the table itself. */
+static void
+vm_reap(struct hash *spt_hash){
+	struct hash_iterator i;
+
+	hash_first(&i, spt_hash);
+	while(hash_next(&i)){
+		struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+		struct frame *frame = page->frame;
+		if(frame == NULL)
+			continue;
+		if(frame->ksm != NULL)
+			ksm_unshare(frame);
+		else if(frame->kva != NULL)
+			palloc_free_page(frame->kva);
+		free(frame);
+		page->frame = NULL;
+	}
+	hash_destroy(spt_hash, remove_spt);
+}
+
+/* reaper daemon.  Frees the memory of exited processes in the
+ * background, so that the exiting thread can wake its parent sooner. */
+static void
+vm_reaperd(void *aux UNUSED){
+	for (;;){
+		struct vm_reap *reap;
+
+		sema_down(&reap_sema);
+		lock_acquire(&reap_lock);
+		reap = list_entry(list_pop_front(&reap_list), struct vm_reap, elem);
+		lock_release(&reap_lock);
+		vm_reap(&reap->spt_hash);
+		free(reap);
+		reaped_cnt++;
+	}
+}
+
 /* 추가 페이지 테이블에서 리소스 보류 해제 */
+/* Tears down the current process's address space.  Dirty file pages
+ * are written back in file order, every user mapping is removed so that
+ * pml4_destroy() only has the page tables left to free, and frames and
+ * swap slots are released in bulk.  Freeing the memory itself is left
+ * to the reaper thread when it is enabled. */
 void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED){
-	if(!hash_empty(&spt->spt_hash)){
-		struct hash_iterator i;
-		struct frame *frame;
+	struct thread *curr = thread_current();
+	struct hash_iterator i;
+	struct vm_reap *reap;
+
+	if(spt->spt_hash.buckets == NULL)
+		return;
+
+	if(curr->pml4 != NULL){
+		vm_writeback_all(&spt->spt_hash, curr->pml4);
 		hash_first(&i, &spt->spt_hash);
-		while(hash_next(&i)){
-			struct page *target = hash_entry(hash_cur(&i), struct page, hash_elem);
-			frame = target->frame;
-			if(target->operations->type == VM_FILE)
-				do_munmap(target->va);
-		}
-		hash_destroy(&spt->spt_hash, remove_spt);
-		free(frame);
+		while(hash_next(&i))
+			pml4_clear_page(curr->pml4, hash_entry(hash_cur(&i), struct page, hash_elem)->va);
+	}
+	vm_detach_frames(&spt->spt_hash);
+	anon_release_all(&spt->spt_hash);
+	shm_release_all(&spt->spt_hash);
+	teardown_cnt++;
+
+	reap = vm_reaper_enabled ? malloc(sizeof *reap) : NULL;
+	if(reap == NULL){
+		vm_reap(&spt->spt_hash);
+		return;
 	}
+	reap->spt_hash = spt->spt_hash;
+	lock_acquire(&reap_lock);
+	list_push_back(&reap_list, &reap->elem);
+	lock_release(&reap_lock);
+	sema_up(&reap_sema);
 }
 
 void remove_spt(struct hash_elem *elem, void *aux){
@@ -347,6 +962,64 @@ void remove_spt(struct hash_elem *elem, void *aux){
 	free(page);
 }
 
+/* Returns true if another frame maps FRAME's physical page, as the
+ * parent and child do after fork().  Must be called with frame_lock
+ * held. */
+bool vm_frame_is_shared(const struct frame *frame){
+	return frame->share_cnt != NULL && *frame->share_cnt > 1;
+}
+
+/* Drops FRAME's share of the physical page it got from fork(), if
+ * any.  Returns true if other frames still map that page.  Must be
+ * called with frame_lock held. */
+static bool
+vm_frame_unshare(struct frame *frame){
+	bool shared;
+
+	if (frame->share_cnt == NULL)
+		return false;
+	shared = --*frame->share_cnt > 0;
+	if (!shared)
+		free(frame->share_cnt);
+	frame->share_cnt = NULL;
+	return shared;
+}
+
+/* Unlinks FRAME from the frame table and releases it.  The physical page
+ * goes back to the pool once no other frame maps it. */
+void vm_free_frame(struct frame *frame){
+	bool shared;
+
+	if (frame->page != NULL){
+		frame->page->frame = NULL;
+		frame->page = NULL;
+	}
+	lock_acquire(&frame_lock);
+	list_remove(&frame->frame_elem);
+	shared = vm_frame_unshare(frame);
+	lock_release(&frame_lock);
+	if (frame->ksm != NULL)
+		ksm_unshare(frame);
+	else if (!shared)
+		palloc_free_page(frame->kva);
+	free(frame);
+}
+
+/* Prints VM statistics. */
+void vm_print_stats(void){
+	printf("VM: %lld faults, %lld fault-around pages, %lld readahead pages\n",
+			fault_cnt, fault_around_cnt, readahead_cnt);
+	printf("VM: %lld zero-page maps, %lld pre-zeroed frames\n",
+			zero_map_cnt, prezeroed_cnt);
+	printf("VM: %lld address spaces torn down, %lld by reaperd\n",
+			teardown_cnt, reaped_cnt);
+	file_backed_print_stats();
+	anon_print_stats();
+	ksm_print_stats();
+	zswap_print_stats();
+	shm_print_stats();
+}
+
 void destroy_frame_table(void){
 	struct list_elem *elem;
 	struct frame *frame;
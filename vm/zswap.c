@@ -0,0 +1,173 @@
+/* zswap.c: Compressed cache in front of the swap disk.
+ *
+ * Anonymous pages being swapped out are compressed into a pool in
+ * kernel memory instead of going to the swap disk.  Pages that do not
+ * shrink to half a page are rejected and written to disk as before.
+ * When the pool is full, its oldest pages are written to the swap disk
+ * in a batch to make room. */
+
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <list.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Total bytes of compressed data the pool may hold. */
+#define ZSWAP_POOL_BYTES (64 * PGSIZE)
+
+/* # of pages written back to disk at a time when the pool is full. */
+#define ZSWAP_BATCH 16
+
+/* A compressed page. */
+struct zswap_entry {
+	struct list_elem elem;   /* Element in zswap_lru. */
+	struct page *page;       /* Page whose contents these are. */
+	size_t size;             /* Compressed size. */
+	uint8_t data[];          /* Compressed contents. */
+};
+
+/* Largest compressed size worth keeping.  Entries stay within one
+ * malloc() arena block. */
+#define ZSWAP_MAX_SIZE (PGSIZE / 2 - sizeof (struct zswap_entry))
+
+/* Compressed pages, oldest first. */
+static struct list zswap_lru;
+static size_t zswap_bytes;
+static struct lock zswap_lock;
+
+/* Scratch space, protected by zswap_lock. */
+static uint8_t zswap_buf[PGSIZE];
+static uint8_t zswap_work[LZ_WORK_SIZE];
+
+/* Statistics. */
+static long long stored_cnt;       /* # of pages compressed into the pool. */
+static long long rejected_cnt;     /* # of pages that compressed badly. */
+static long long loaded_cnt;       /* # of pages swapped in from the pool. */
+static long long writeback_cnt;    /* # of pages written back to disk. */
+static long long stored_bytes;     /* Total compressed size of stores. */
+
+void
+zswap_init (void) {
+	list_init (&zswap_lru);
+	lock_init (&zswap_lock);
+}
+
+static void
+zswap_remove (struct zswap_entry *e) {
+	list_remove (&e->elem);
+	zswap_bytes -= e->size;
+	e->page->anon.zswap = NULL;
+	free (e);
+}
+
+/* Writes the oldest pages in the pool to the swap disk until at least
+ * ZSWAP_BATCH pages or NEED bytes are gone, whichever is more.  Stops
+ * early if the swap disk is full.  Must be called with zswap_lock
+ * held. */
+static void
+zswap_writeback (size_t need) {
+	size_t freed = 0, cnt = 0;
+
+	while (!list_empty (&zswap_lru) && (cnt < ZSWAP_BATCH || freed < need)) {
+		struct zswap_entry *e = list_entry (list_front (&zswap_lru),
+				struct zswap_entry, elem);
+		struct page *page = e->page;
+		size_t slot;
+
+		if (!lz_decompress (e->data, e->size, zswap_buf, PGSIZE))
+			PANIC ("zswap: corrupt entry");
+		slot = anon_write_slot (zswap_buf);
+		if (slot == BITMAP_ERROR)
+			break;
+		freed += e->size;
+		cnt++;
+		zswap_remove (e);
+		page->anon.idx = slot;
+		writeback_cnt++;
+	}
+}
+
+/* Compresses the contents of PAGE, found at KVA, into the pool.  Returns false,
+ * leaving the page for the swap disk, if it does not compress well or
+ * no room can be made for it. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	struct zswap_entry *e;
+	size_t size;
+
+	lock_acquire (&zswap_lock);
+	size = lz_compress (kva, PGSIZE, zswap_buf, ZSWAP_MAX_SIZE,
+			zswap_work);
+	if (size == 0) {
+		rejected_cnt++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+	if (zswap_bytes + size > ZSWAP_POOL_BYTES)
+		zswap_writeback (zswap_bytes + size - ZSWAP_POOL_BYTES);
+	e = zswap_bytes + size <= ZSWAP_POOL_BYTES
+		? malloc (sizeof *e + size) : NULL;
+	if (e == NULL) {
+		lock_release (&zswap_lock);
+		return false;
+	}
+
+	e->page = page;
+	e->size = size;
+	memcpy (e->data, zswap_buf, size);
+	list_push_back (&zswap_lru, &e->elem);
+	zswap_bytes += size;
+	page->anon.zswap = e;
+	stored_cnt++;
+	stored_bytes += size;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Decompresses PAGE into KVA and drops it from the pool.  Returns false
+ * if PAGE is not in the pool, e.g. because it was written back. */
+bool
+zswap_load (struct page *page, void *kva) {
+	struct zswap_entry *e;
+
+	lock_acquire (&zswap_lock);
+	e = page->anon.zswap;
+	if (e == NULL) {
+		lock_release (&zswap_lock);
+		return false;
+	}
+	if (!lz_decompress (e->data, e->size, kva, PGSIZE))
+		PANIC ("zswap: corrupt entry");
+	zswap_remove (e);
+	loaded_cnt++;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Drops PAGE from the pool, if it is there. */
+void
+zswap_free (struct page *page) {
+	lock_acquire (&zswap_lock);
+	if (page->anon.zswap != NULL)
+		zswap_remove (page->anon.zswap);
+	lock_release (&zswap_lock);
+}
+
+/* Prints zswap statistics. */
+void
+zswap_print_stats (void) {
+	long long ratio = stored_bytes ? stored_cnt * PGSIZE * 100 / stored_bytes : 0;
+	long long sectors = (stored_cnt - writeback_cnt + loaded_cnt)
+		* (PGSIZE / DISK_SECTOR_SIZE);
+
+	printf ("zswap: %lld stored, %lld rejected, %lld loaded, %lld written back\n",
+			stored_cnt, rejected_cnt, loaded_cnt, writeback_cnt);
+	printf ("zswap: compression ratio %lld.%02lld, %lld disk sectors avoided\n",
+			ratio / 100, ratio % 100, sectors);
+}